@@ -0,0 +1,782 @@
+#include "../include/catalogue_image.h"
+#include "../include/connection_scan.h"
+#include "../include/geo.h"
+#include "../include/json.h"
+#include "../include/landmarks.h"
+#include "../include/mutation_log.h"
+#include "../include/router.h"
+#include "../include/stop_search.h"
+#include "../include/timetable.h"
+#include "../include/transport_catalogue.h"
+#include "../include/transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+
+/*
+    Замеры производительности: make bench или build/bench/bench [название замера ...].
+    Справочник для замеров — решётка side x side остановок, по каждой строке и каждому столбцу
+    ходит свой автобус, поэтому размер графа задаётся одним числом, а маршруты идут с пересадками.
+*/
+
+using namespace std::literals;
+
+namespace
+{
+template <typename Function> double MeasureMs(Function &&function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    function();
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string GetStopName(size_t row, size_t column)
+{
+    return "Остановка "s + std::to_string(row) + "-"s + std::to_string(column);
+}
+
+// Соседние остановки решётки — в 600 м друг от друга по дорогам
+std::unique_ptr<tc::TransportCatalogue> MakeGridCatalogue(size_t side)
+{
+    auto catalogue = std::make_unique<tc::TransportCatalogue>();
+
+    for (size_t row = 0; row < side; ++row)
+    {
+        for (size_t column = 0; column < side; ++column)
+        {
+            catalogue->AddStop({GetStopName(row, column), {55.5 + 0.005 * row, 37.5 + 0.008 * column}, {}});
+        }
+    }
+
+    for (size_t line = 0; line < side; ++line)
+    {
+        std::vector<const tc::Stop *> row_stops;
+        std::vector<const tc::Stop *> column_stops;
+
+        for (size_t i = 0; i < side; ++i)
+        {
+            row_stops.push_back(catalogue->GetStop(GetStopName(line, i)));
+            column_stops.push_back(catalogue->GetStop(GetStopName(i, line)));
+        }
+
+        for (const auto *stops : {&row_stops, &column_stops})
+        {
+            for (size_t i = 0; i + 1 < stops->size(); ++i)
+            {
+                catalogue->SetDistance((*stops)[i], (*stops)[i + 1], 600);
+                catalogue->SetDistance((*stops)[i + 1], (*stops)[i], 600);
+            }
+        }
+
+        catalogue->AddBus({"Ряд "s + std::to_string(line), std::move(row_stops), false});
+        catalogue->AddBus({"Столбец "s + std::to_string(line), std::move(column_stops), false});
+    }
+
+    return catalogue;
+}
+
+tc::RoutingSettings MakeRoutingSettings(tc::RouteEngine route_engine)
+{
+    tc::RoutingSettings routing_settings;
+    routing_settings.bus_wait_time_ = 6;
+    routing_settings.bus_velocity_ = 40.0;
+    routing_settings.route_engine_ = route_engine;
+
+    return routing_settings;
+}
+
+// Пары различных остановок, одни и те же при каждом запуске
+std::vector<std::pair<const tc::Stop *, const tc::Stop *>> MakeStopPairs(const tc::TransportCatalogue &catalogue,
+                                                                         size_t count)
+{
+    std::vector<const tc::Stop *> stops;
+    std::mt19937 generator(42);
+
+    for (const auto &[name, stop] : catalogue.GetAllStops())
+    {
+        stops.push_back(stop);
+    }
+
+    std::uniform_int_distribution<size_t> index(0, stops.size() - 1);
+    std::vector<std::pair<const tc::Stop *, const tc::Stop *>> pairs;
+
+    while (pairs.size() < count)
+    {
+        if (const auto from = index(generator), to = index(generator); from != to)
+        {
+            pairs.emplace_back(stops[from], stops[to]);
+        }
+    }
+
+    return pairs;
+}
+
+// Число символов строки UTF-8, для выравнивания столбцов
+size_t StringLength(std::string_view text)
+{
+    return std::count_if(text.begin(), text.end(),
+                         [](char c) { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; });
+}
+
+bool IsSameRoute(const std::optional<graph::Router<double>::RouteInfo> &lhs,
+                 const std::optional<graph::Router<double>::RouteInfo> &rhs)
+{
+    return lhs.has_value() == rhs.has_value() && (!lhs || (lhs->weight == rhs->weight && lhs->edges == rhs->edges));
+}
+
+// Предрасчёт таблицы всех пар на 1–32 потоках; маршруты должны совпасть с однопоточными
+void BenchRouterThreads()
+{
+    const auto catalogue = MakeGridCatalogue(18);
+    const tc::TransportRouter transport_router(MakeRoutingSettings(tc::RouteEngine::ALT), *catalogue);
+    const auto &graph = transport_router.GetRouteGraph();
+    const size_t vertex_count = graph.GetVertexCount();
+
+    std::cout << "router_threads: "sv << vertex_count << " vertices, "sv << std::thread::hardware_concurrency()
+              << " hardware threads\n"sv;
+    std::cout << "threads    build_ms    speedup    same_routes\n"sv;
+
+    std::unique_ptr<graph::Router<double>> reference;
+    double reference_ms = 0.0;
+
+    for (const size_t thread_count : {1, 2, 4, 8, 16, 32})
+    {
+        std::unique_ptr<graph::Router<double>> router;
+        const double build_ms =
+            MeasureMs([&] { router = std::make_unique<graph::Router<double>>(graph, thread_count); });
+        bool same_routes = true;
+
+        if (!reference)
+        {
+            reference = std::move(router);
+            reference_ms = build_ms;
+        }
+
+        else
+        {
+            for (graph::VertexId from = 0; from < vertex_count && same_routes; ++from)
+            {
+                for (graph::VertexId to = 0; to < vertex_count && same_routes; ++to)
+                {
+                    same_routes = IsSameRoute(router->BuildRoute(from, to), reference->BuildRoute(from, to));
+                }
+            }
+        }
+
+        std::cout << std::setw(7) << thread_count << std::setw(12) << std::fixed << std::setprecision(1) << build_ms
+                  << std::setw(11) << std::setprecision(2) << reference_ms / build_ms << std::setw(15)
+                  << (same_routes ? "yes"sv : "NO"sv) << '\n';
+    }
+}
+
+// Самое раннее прибытие: CSA против Дейкстры по расписанию, и для сравнения — ответ графового маршрутизатора
+// по таблице всех пар без учёта времени отправления
+void BenchConnectionScan()
+{
+    const auto catalogue = MakeGridCatalogue(18);
+    auto routing_settings = MakeRoutingSettings(tc::RouteEngine::ALL_PAIRS);
+    routing_settings.timetable_engine_ = tc::TimetableEngine::CONNECTION_SCAN;
+    const tc::TransportRouter transport_router(routing_settings, *catalogue);
+    const auto stop_pairs = MakeStopPairs(*catalogue, 2000);
+
+    std::vector<double> depart_times;
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> depart_at(6 * 60.0, 22 * 60.0);
+
+    for (size_t i = 0; i < stop_pairs.size(); ++i)
+    {
+        depart_times.push_back(depart_at(generator));
+    }
+
+    std::vector<std::optional<timetable::Journey>> scan_journeys(stop_pairs.size());
+    std::vector<std::optional<timetable::Journey>> dijkstra_journeys(stop_pairs.size());
+
+    const double scan_ms = MeasureMs([&] {
+        for (size_t i = 0; i < stop_pairs.size(); ++i)
+        {
+            scan_journeys[i] = transport_router.GetJourney(stop_pairs[i].first, stop_pairs[i].second, depart_times[i]);
+        }
+    });
+    const double dijkstra_ms = MeasureMs([&] {
+        for (size_t i = 0; i < stop_pairs.size(); ++i)
+        {
+            dijkstra_journeys[i] = timetable::FindEarliestArrival(
+                transport_router.GetTimetable(), stop_pairs[i].first, stop_pairs[i].second, depart_times[i]);
+        }
+    });
+    size_t route_count = 0;
+    const double router_ms = MeasureMs([&] {
+        for (const auto &[from, to] : stop_pairs)
+        {
+            route_count += transport_router.GetRoute(from, to).has_value();
+        }
+    });
+
+    const size_t same_count = std::count_if(
+        stop_pairs.begin(), stop_pairs.end(), [&, i = size_t{0}](const auto &) mutable {
+            const auto &scan = scan_journeys[i];
+            const auto &dijkstra = dijkstra_journeys[i++];
+            return scan.has_value() == dijkstra.has_value() &&
+                   (!scan || std::abs(scan->arrival - dijkstra->arrival) < 1e-9);
+        });
+
+    std::cout << "connection_scan: "sv << catalogue->GetAllStops().size() << " stops, "sv << stop_pairs.size()
+              << " queries\n"sv;
+    std::cout << "engine                   us_per_query\n"sv << std::fixed << std::setprecision(2);
+    std::cout << "connection scan   "sv << std::setw(17) << scan_ms * 1000 / stop_pairs.size() << '\n';
+    std::cout << "timetable dijkstra"sv << std::setw(17) << dijkstra_ms * 1000 / stop_pairs.size() << '\n';
+    std::cout << "graph router      "sv << std::setw(17) << router_ms * 1000 / stop_pairs.size() << '\n';
+    std::cout << "same arrivals as dijkstra: "sv << same_count << " of "sv << stop_pairs.size() << ", routes found: "sv
+              << route_count << '\n';
+}
+
+// Поиск маршрута на каждый запрос: Дейкстра против A* с ориентирами. Просмотренные вершины — те,
+// для которых поиск вычислил оценку: каждая достигнутая вершина, по одному разу за запрос
+void BenchLandmarks()
+{
+    const auto catalogue = MakeGridCatalogue(60);
+    const tc::TransportRouter transport_router(MakeRoutingSettings(tc::RouteEngine::ALT), *catalogue);
+    const auto &graph = transport_router.GetRouteGraph();
+    const auto stop_pairs = MakeStopPairs(*catalogue, 500);
+
+    std::map<const tc::Stop *, graph::VertexId> stop_vertices;
+    std::vector<graph::VertexId> candidates;
+
+    for (graph::VertexId vertex = 0; vertex < graph.GetVertexCount(); vertex += 2)
+    {
+        stop_vertices[transport_router.GetVertexStop(vertex)] = vertex;
+        candidates.push_back(vertex);
+    }
+
+    const graph::LandmarkIndex<double> landmarks(graph, candidates, 8, 1);
+
+    std::cout << "landmarks: "sv << graph.GetVertexCount() << " vertices, "sv << stop_pairs.size() << " queries, "sv
+              << landmarks.GetLandmarks().size() << " landmarks\n"sv;
+    std::cout << "search                      us_per_query    visited_per_query    same_weights\n"sv;
+
+    std::vector<double> reference_weights;
+
+    auto run = [&](std::string_view name, auto heuristic) {
+        size_t visited = 0;
+        std::vector<double> weights;
+        const double ms = MeasureMs([&] {
+            for (const auto &[from, to] : stop_pairs)
+            {
+                const graph::VertexId vertex_to = stop_vertices.at(to);
+                const auto route = graph::FindRouteAStar(graph, stop_vertices.at(from), vertex_to,
+                                                         [&](graph::VertexId vertex) {
+                                                             ++visited;
+                                                             return heuristic(vertex, vertex_to);
+                                                         });
+                weights.push_back(route ? route->weight : -1.0);
+            }
+        });
+
+        if (reference_weights.empty())
+        {
+            reference_weights = weights;
+        }
+
+        const bool same_weights = std::equal(weights.begin(), weights.end(), reference_weights.begin(),
+                                             [](double lhs, double rhs) { return std::abs(lhs - rhs) < 1e-9; });
+        std::cout << name << std::setw(38 - name.size()) << std::fixed << std::setprecision(2)
+                  << ms * 1000 / stop_pairs.size() << std::setw(21) << std::setprecision(0)
+                  << static_cast<double>(visited) / stop_pairs.size() << std::setw(16)
+                  << (same_weights ? "yes"sv : "NO"sv) << '\n';
+    };
+
+    run("dijkstra"sv, [](graph::VertexId, graph::VertexId) { return 0.0; });
+    run("alt, landmark bounds"sv,
+        [&](graph::VertexId vertex, graph::VertexId vertex_to) { return landmarks.GetLowerBound(vertex, vertex_to); });
+
+    // Движок ALT маршрутизатора добавляет к оценкам ориентиров оценку по координатам и ожиданию автобуса
+    const double engine_ms = MeasureMs([&] {
+        for (const auto &[from, to] : stop_pairs)
+        {
+            transport_router.GetRoute(from, to);
+        }
+    });
+    std::cout << "route_engine alt"sv << std::setw(22) << std::setprecision(2) << engine_ms * 1000 / stop_pairs.size()
+              << std::setw(21) << '-' << std::setw(16) << '-' << '\n';
+}
+
+// Поиск по началу слов на 100 тысячах названий из трёх слов: среднее время и 99-й процентиль
+void BenchStopSearch()
+{
+    const std::vector<std::string> words = {
+        "Поворот"s, "Полушкино"s, "Ривьерский"s, "Морской"s, "Улица"s,   "Академика"s, "Парк"s,  "Вокзал"s,
+        "Рынок"s,   "Школа"s,     "Больница"s,   "Мост"s,    "Площадь"s, "Заводская"s, "Лесная"s, "Ёлочка"s,
+        "Central"s, "Station"s,   "Market"s,     "Bridge"s,  "River"s,   "Garden"s,    "Square"s, "Tower"s};
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> word(0, words.size() - 1);
+    std::deque<tc::Stop> stops;
+    search::StopNameIndex index;
+
+    for (size_t i = 0; stops.size() < 100000; ++i)
+    {
+        const std::string name = words[word(generator)] + " "s + words[word(generator)] + " "s +
+                                 words[word(generator)] + " "s + std::to_string(i);
+        stops.push_back({name, {}, {}});
+        index.Add(&stops.back());
+    }
+
+    std::cout << "stop_search: "sv << stops.size() << " names\n"sv;
+    std::cout << "query                        max_edits    mean_us    p99_us    mean_total\n"sv;
+
+    const std::vector<std::pair<std::string, size_t>> queries = {
+        {"пол"s, 0}, {"полушк"s, 0}, {"полушк"s, 1}, {"ривьерски"s, 1},
+        {"ёлоч"s, 0}, {"stat"s, 0},   {"sttion"s, 1}, {"4242"s, 0}};
+
+    for (const auto &[query, max_edits] : queries)
+    {
+        std::vector<double> times;
+        size_t total = 0;
+
+        for (size_t i = 0; i < 200; ++i)
+        {
+            times.push_back(MeasureMs([&] { total += index.Find(query, max_edits, i % 5 * 10, 10).total; }) * 1000);
+        }
+
+        std::sort(times.begin(), times.end());
+        std::cout << query << std::setw(40 - StringLength(query)) << max_edits << std::setw(11) << std::fixed
+                  << std::setprecision(1) << std::accumulate(times.begin(), times.end(), 0.0) / times.size()
+                  << std::setw(10) << times[times.size() * 99 / 100] << std::setw(14) << total / times.size() << '\n';
+    }
+}
+
+// Разбор запросов и чтение полей: json::Dict в непрерывном массиве против std::map с теми же данными.
+// Отдельно — разбор одного объекта с 40 тысячами ключей, где квадратичная вставка была бы заметна
+void BenchJsonDict()
+{
+    std::ostringstream requests;
+    requests << "["sv;
+
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        requests << (i ? ","sv : ""sv) << R"({"id": )"sv << i << R"(, "type": "Route", "from": "Остановка )"sv
+                 << i % 977 << R"(", "to": "Остановка )"sv << i % 911 << R"(", "name": "Маршрут )"sv << i % 97
+                 << R"("})"sv;
+    }
+
+    requests << "]"sv;
+
+    const std::string text = requests.str();
+    json::Document document{json::Node{}};
+    const double parse_ms = MeasureMs([&] {
+        std::istringstream input(text);
+        document = json::Load(input);
+    });
+
+    // Оба представления строятся копированием из разобранного документа, чтобы узлы лежали в памяти одинаково
+    using Map = std::map<std::string, json::Node>;
+    std::vector<json::Dict> dicts;
+    std::vector<Map> maps;
+    const double dict_build_ms = MeasureMs([&] {
+        for (const auto &request : document.GetRoot().AsArray())
+        {
+            dicts.emplace_back(request.AsDict());
+        }
+    });
+    const double map_build_ms = MeasureMs([&] {
+        for (const auto &request : document.GetRoot().AsArray())
+        {
+            maps.emplace_back(request.AsDict().begin(), request.AsDict().end());
+        }
+    });
+
+    // Лучшее время из нескольких проходов по всем объектам; checksum — чтобы чтения не выбросил оптимизатор
+    auto measure_lookups = [](const auto &objects, size_t &checksum) {
+        double best_ms = std::numeric_limits<double>::infinity();
+
+        for (size_t round = 0; round < 5; ++round)
+        {
+            checksum = 0;
+            best_ms = std::min(best_ms, MeasureMs([&] {
+                                   for (const auto &dict : objects)
+                                   {
+                                       checksum += dict.at("id"s).AsInt() + dict.at("type"s).AsString().size() +
+                                                   dict.at("from"s).AsString().size() +
+                                                   dict.at("name"s).AsString().size();
+                                   }
+                               }));
+        }
+
+        return best_ms;
+    };
+
+    // Обход всех полей — то, что делает с разобранным объектом JsonReader и печать ответа
+    auto measure_iteration = [](const auto &objects, size_t &checksum) {
+        double best_ms = std::numeric_limits<double>::infinity();
+
+        for (size_t round = 0; round < 5; ++round)
+        {
+            checksum = 0;
+            best_ms = std::min(best_ms, MeasureMs([&] {
+                                   for (const auto &dict : objects)
+                                   {
+                                       for (const auto &[key, value] : dict)
+                                       {
+                                           checksum += key.size() + (value.IsString() ? 1 : 0);
+                                       }
+                                   }
+                               }));
+        }
+
+        return best_ms;
+    };
+
+    size_t dict_checksum = 0;
+    size_t map_checksum = 0;
+    const double dict_lookup_ms = measure_lookups(dicts, dict_checksum);
+    const double map_lookup_ms = measure_lookups(maps, map_checksum);
+
+    size_t dict_iteration_checksum = 0;
+    size_t map_iteration_checksum = 0;
+    const double dict_iteration_ms = measure_iteration(dicts, dict_iteration_checksum);
+    const double map_iteration_ms = measure_iteration(maps, map_iteration_checksum);
+
+    std::ostringstream wide;
+    wide << "{"sv;
+
+    for (size_t i = 0; i < 40000; ++i)
+    {
+        wide << (i ? ","sv : ""sv) << "\"key "sv << (i * 7919) % 40000 << "\": "sv << i;
+    }
+
+    wide << "}"sv;
+
+    const double wide_parse_ms = MeasureMs([text = wide.str()] {
+        std::istringstream input(text);
+        json::Load(input);
+    });
+
+    const size_t lookup_count = 4 * dicts.size();
+    std::cout << "json_dict: "sv << dicts.size() << " objects of 5 keys, "sv << text.size() / 1024 << " KiB\n"sv;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "parse into flat dict:      "sv << std::setw(9) << parse_ms << " ms\n"sv;
+    std::cout << "copy into flat dict:       "sv << std::setw(9) << dict_build_ms << " ms\n"sv;
+    std::cout << "copy into std::map:        "sv << std::setw(9) << map_build_ms << " ms\n"sv;
+    std::cout << "lookup in flat dict:       "sv << std::setw(9) << dict_lookup_ms * 1e6 / lookup_count
+              << " ns per at()\n"sv;
+    std::cout << "lookup in std::map:        "sv << std::setw(9) << map_lookup_ms * 1e6 / lookup_count
+              << " ns per at()\n"sv;
+    std::cout << "iterate flat dict:         "sv << std::setw(9) << dict_iteration_ms << " ms\n"sv;
+    std::cout << "iterate std::map:          "sv << std::setw(9) << map_iteration_ms << " ms\n"sv;
+    std::cout << "parse object of 40000 keys:"sv << std::setw(9) << wide_parse_ms << " ms\n"sv;
+    std::cout << "same fields: "sv
+              << (dict_checksum == map_checksum && dict_iteration_checksum == map_iteration_checksum ? "yes"sv : "NO"sv)
+              << '\n';
+}
+
+// Расстояние в метрах по гаверсинусу в long double: эталон для проверки точности.
+// Градусы переводятся в радианы с тем же приближением числа пи, что в geo
+double ComputeReferenceDistance(geo::Coordinates from, geo::Coordinates to)
+{
+    const long double dr = 3.1415926535L / 180;
+    const long double sin_lat = std::sin((to.lat - from.lat) * dr / 2);
+    const long double sin_lng = std::sin((to.lng - from.lng) * dr / 2);
+    const long double square =
+        sin_lat * sin_lat + std::cos(from.lat * dr) * std::cos(to.lat * dr) * sin_lng * sin_lng;
+
+    return static_cast<double>(2 * geo::EARTH_RADIUS * std::asin(std::min(1.0L, std::sqrt(square))));
+}
+
+// Расстояния от одной точки до пакета точек: по одной через acos, по одной через SpherePoint и пакетом.
+// Точность — наибольшая относительная погрешность относительно эталона на городских и дальних расстояниях
+void BenchGeoBatch()
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> city_lat(55.55, 55.95);
+    std::uniform_real_distribution<double> city_lng(37.3, 37.9);
+    std::uniform_real_distribution<double> world_lat(-80.0, 80.0);
+    std::uniform_real_distribution<double> world_lng(-180.0, 180.0);
+    const geo::Coordinates origin{55.75, 37.62};
+
+    std::cout << "geo_batch: distances from one point, 20 passes\n"sv;
+    std::cout << "points     method            ns_per_distance    max_relative_error\n"sv;
+
+    for (const bool is_world : {false, true})
+    {
+        std::vector<geo::Coordinates> points;
+        std::vector<geo::SpherePoint> sphere_points;
+
+        for (size_t i = 0; i < 100000; ++i)
+        {
+            points.push_back(is_world ? geo::Coordinates{world_lat(generator), world_lng(generator)}
+                                      : geo::Coordinates{city_lat(generator), city_lng(generator)});
+            sphere_points.push_back(geo::ToSpherePoint(points.back()));
+        }
+
+        const geo::CoordinateBatch batch(points);
+        const geo::SpherePoint origin_point = geo::ToSpherePoint(origin);
+        std::vector<double> scalar(points.size());
+        std::vector<double> sphere(points.size());
+        std::vector<double> batched;
+
+        const double scalar_ms = MeasureMs([&] {
+            for (size_t pass = 0; pass < 20; ++pass)
+            {
+                for (size_t i = 0; i < points.size(); ++i)
+                {
+                    scalar[i] = geo::ComputeDistance(origin, points[i]);
+                }
+            }
+        });
+        const double sphere_ms = MeasureMs([&] {
+            for (size_t pass = 0; pass < 20; ++pass)
+            {
+                for (size_t i = 0; i < points.size(); ++i)
+                {
+                    sphere[i] = geo::ComputeDistance(origin_point, sphere_points[i]);
+                }
+            }
+        });
+        const double batch_ms = MeasureMs([&] {
+            for (size_t pass = 0; pass < 20; ++pass)
+            {
+                batch.ComputeDistancesTo(origin_point, batched);
+            }
+        });
+
+        auto max_error = [&](const std::vector<double> &distances) {
+            double error = 0.0;
+
+            for (size_t i = 0; i < points.size(); ++i)
+            {
+                const double reference = ComputeReferenceDistance(origin, points[i]);
+                error = std::max(error, std::abs(distances[i] - reference) / reference);
+            }
+
+            return error;
+        };
+
+        const std::string_view name = is_world ? "world"sv : "city"sv;
+        const double count = 20.0 * points.size();
+
+        for (const auto &[method, ms, distances] :
+             {std::tuple{"scalar acos"sv, scalar_ms, &scalar}, std::tuple{"scalar sphere"sv, sphere_ms, &sphere},
+              std::tuple{"batch"sv, batch_ms, &batched}})
+        {
+            std::cout << name << std::setw(11 - name.size()) << ' ' << method << std::setw(32 - method.size())
+                      << std::fixed << std::setprecision(2) << ms * 1e6 / count << std::setw(22) << std::scientific
+                      << std::setprecision(1) << max_error(*distances) << '\n';
+        }
+    }
+}
+
+// Содержимое справочника одной строкой: остановки, маршруты и расстояния в порядке названий
+std::string DescribeCatalogue(const tc::TransportCatalogue &catalogue)
+{
+    std::ostringstream out;
+    out << std::setprecision(17);
+
+    for (const auto &[name, stop] : catalogue.GetAllStops())
+    {
+        out << name << ' ' << stop->coordinates.lat << ' ' << stop->coordinates.lng;
+
+        for (const auto &bus : stop->buses)
+        {
+            out << ' ' << std::string_view(bus);
+        }
+
+        out << '\n';
+    }
+
+    for (const auto &[number, bus] : catalogue.GetAllBuses())
+    {
+        out << number << ' ' << bus->is_roundtrip;
+
+        for (const tc::Stop *stop : bus->stops)
+        {
+            out << " / "sv << std::string_view(stop->name);
+        }
+
+        out << '\n';
+    }
+
+    std::vector<std::tuple<std::string_view, std::string_view, int>> distances;
+
+    for (const auto &[stops, distance] : catalogue.GetAllDistances())
+    {
+        distances.emplace_back(stops.first->name, stops.second->name, distance);
+    }
+
+    std::sort(distances.begin(), distances.end());
+
+    for (const auto &[from, to, distance] : distances)
+    {
+        out << from << " -> "sv << to << ' ' << distance << '\n';
+    }
+
+    return out.str();
+}
+
+// Изменения PUT /stop, PUT /bus и PATCH /patch вперемешку, одни и те же при каждом запуске
+std::vector<std::string> MakeMutationRecords(size_t side, size_t count)
+{
+    std::vector<std::string> records;
+    std::mt19937 generator(11);
+    std::uniform_int_distribution<size_t> line(0, side - 1);
+    size_t stop_count = 0;
+    size_t bus_count = 0;
+
+    const auto random_stop = [&] {
+        return stop_count > 0 && generator() % 2 ? "Новая "s + std::to_string(generator() % stop_count)
+                                                 : GetStopName(line(generator), line(generator));
+    };
+
+    while (records.size() < count)
+    {
+        std::ostringstream body;
+        body << "{\"base_requests\": ["sv;
+
+        switch (records.size() % 3)
+        {
+        case 0:
+            body << "{\"type\": \"Stop\", \"name\": \"Новая "sv << stop_count++ << "\", \"latitude\": "sv
+                 << 55.5 + 0.001 * line(generator) << ", \"longitude\": "sv << 37.5 + 0.001 * line(generator)
+                 << ", \"road_distances\": {\""sv << random_stop() << "\": "sv << 100 + generator() % 900 << "}}"sv;
+            break;
+        case 1:
+            body << "{\"type\": \"Bus\", \"name\": \"Новый "sv << bus_count++ << "\", \"stops\": [\""sv
+                 << random_stop() << "\", \""sv << random_stop() << "\", \""sv << random_stop()
+                 << "\"], \"is_roundtrip\": "sv << (generator() % 2 ? "true"sv : "false"sv) << '}';
+            break;
+        default:
+            body << "{\"type\": \"Bus\", \"name\": \"Ряд "sv << line(generator) << "\", \"stops\": [\""sv
+                 << random_stop() << "\"], \"position\": "sv << line(generator) << ", \"is_roundtrip\": "sv
+                 << (generator() % 2 ? "true"sv : "false"sv) << '}';
+            break;
+        }
+
+        body << "]}"sv;
+
+        std::istringstream input(body.str());
+        const json::Document document = json::Load(input);
+        const json::Array &base_requests = document.GetRoot().AsDict().at("base_requests"s).AsArray();
+        records.push_back(records.size() % 3 == 2 ? wal::EncodePatch(base_requests) : wal::EncodePut(base_requests));
+    }
+
+    return records;
+}
+
+// Перезапуск с журналом: изменения применяются к справочнику из снимка и пишутся в журнал, затем журнал
+// открывается заново и применяется к тому же снимку. Справочник после перезапуска должен совпасть с живым
+void BenchWalReplay()
+{
+    constexpr size_t side = 20;
+    const auto catalogue = MakeGridCatalogue(side);
+    const tc::TransportRouter transport_router(MakeRoutingSettings(tc::RouteEngine::ALT), *catalogue);
+    const auto records = MakeMutationRecords(side, 3000);
+
+    const std::filesystem::path data_dir =
+        std::filesystem::temp_directory_path() / ("tc_bench_wal_"s + std::to_string(::getpid()));
+    std::filesystem::create_directories(data_dir);
+    const std::string snapshot_path = data_dir / "snapshot.img";
+    const std::string log_path = data_dir / "wal.log";
+    image::WriteImage(snapshot_path, *catalogue, transport_router, "{}"sv);
+
+    tc::TransportCatalogue live;
+    image::CatalogueImage(snapshot_path).FillTransportCatalogue(live);
+    double apply_ms = 0.0;
+    double durable_ms = 0.0;
+
+    {
+        wal::MutationLog log(log_path, wal::LogSettings{});
+        uint64_t seq = 0;
+
+        apply_ms = MeasureMs([&] {
+            for (const auto &record : records)
+            {
+                wal::ApplyRecord(record, live);
+                seq = log.Append(record);
+            }
+        });
+        durable_ms = MeasureMs([&] { log.WaitDurable(seq); });
+    }
+
+    tc::TransportCatalogue restored;
+    size_t recovered_count = 0;
+    const double replay_ms = MeasureMs([&] {
+        image::CatalogueImage(snapshot_path).FillTransportCatalogue(restored);
+        wal::MutationLog log(log_path, wal::LogSettings{});
+        const auto recovered = log.TakeRecoveredRecords();
+        recovered_count = recovered.size();
+
+        for (const auto &record : recovered)
+        {
+            wal::ApplyRecord(record, restored);
+        }
+    });
+
+    const auto log_size = std::filesystem::file_size(log_path);
+    std::filesystem::remove_all(data_dir);
+
+    std::cout << "wal_replay: "sv << catalogue->GetAllStops().size() << " stops, "sv << records.size()
+              << " mutations, log "sv << log_size / 1024 << " KiB\n"sv;
+    std::cout << "stage                        ms\n"sv << std::fixed << std::setprecision(2);
+    std::cout << "apply and append  "sv << std::setw(13) << apply_ms << '\n';
+    std::cout << "wait durable      "sv << std::setw(13) << durable_ms << '\n';
+    std::cout << "restart and replay"sv << std::setw(13) << replay_ms << '\n';
+    std::cout << "records recovered: "sv << recovered_count << " of "sv << records.size()
+              << ", catalogue after restart matches live: "sv
+              << (DescribeCatalogue(live) == DescribeCatalogue(restored) ? "yes"sv : "no"sv) << '\n';
+}
+
+struct BenchCase
+{
+    std::string_view name;
+    void (*run)();
+};
+
+const BenchCase BENCH_CASES[] = {
+    {"router_threads"sv, BenchRouterThreads},
+    {"connection_scan"sv, BenchConnectionScan},
+    {"landmarks"sv, BenchLandmarks},
+    {"stop_search"sv, BenchStopSearch},
+    {"geo_batch"sv, BenchGeoBatch},
+    {"json_dict"sv, BenchJsonDict},
+    {"wal_replay"sv, BenchWalReplay},
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::vector<std::string_view> names(argv + 1, argv + argc);
+
+    for (const auto name : names)
+    {
+        if (std::none_of(std::begin(BENCH_CASES), std::end(BENCH_CASES),
+                         [name](const BenchCase &bench_case) { return bench_case.name == name; }))
+        {
+            std::cerr << "Unknown benchmark: "sv << name << '\n';
+            return 1;
+        }
+    }
+
+    for (const auto &bench_case : BENCH_CASES)
+    {
+        if (names.empty() || std::count(names.begin(), names.end(), bench_case.name))
+        {
+            bench_case.run();
+            std::cout << '\n';
+        }
+    }
+
+    return 0;
+}
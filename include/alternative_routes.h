@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "router.h"
+
+namespace graph
+{
+namespace detail
+{
+// Рабочее состояние поиска, переиспользуемое между запросами одного потока. Массивы не очищаются:
+// значение ячейки действительно, только если её метка равна метке текущего поиска (или запрета)
+template <typename Weight> struct AlternativeSearchState
+{
+    std::vector<Weight> distances;
+    std::vector<EdgeId> prev_edges;
+    std::vector<uint32_t> distance_stamps;
+    std::vector<uint32_t> banned_vertex_stamps;
+    std::vector<uint32_t> banned_edge_stamps;
+    std::vector<std::pair<Weight, VertexId>> queue;
+    uint32_t search_stamp = 0;
+    uint32_t ban_stamp = 0;
+
+    void Prepare(size_t vertex_count, size_t edge_count)
+    {
+        if (distances.size() < vertex_count)
+        {
+            distances.resize(vertex_count);
+            prev_edges.resize(vertex_count);
+            distance_stamps.resize(vertex_count, 0);
+            banned_vertex_stamps.resize(vertex_count, 0);
+        }
+
+        if (banned_edge_stamps.size() < edge_count)
+        {
+            banned_edge_stamps.resize(edge_count, 0);
+        }
+    }
+
+    static uint32_t NextStamp(uint32_t &stamp, std::vector<uint32_t> &first, std::vector<uint32_t> &second)
+    {
+        if (++stamp == 0)
+        {
+            std::fill(first.begin(), first.end(), 0);
+            std::fill(second.begin(), second.end(), 0);
+            stamp = 1;
+        }
+
+        return stamp;
+    }
+
+    void NewBans()
+    {
+        NextStamp(ban_stamp, banned_vertex_stamps, banned_edge_stamps);
+    }
+
+    // Дейкстра от from до to в обход запрещённых вершин и рёбер; пути тяжелее budget не рассматриваются
+    std::optional<typename Router<Weight>::RouteInfo> FindPath(const DirectedWeightedGraph<Weight> &graph,
+                                                               VertexId from, VertexId to, Weight budget)
+    {
+        const uint32_t stamp = NextStamp(search_stamp, distance_stamps, distance_stamps);
+        const std::greater<std::pair<Weight, VertexId>> later;
+        auto reached = [&](VertexId vertex) { return distance_stamps[vertex] == stamp; };
+
+        queue.clear();
+        distances[from] = Weight{};
+        distance_stamps[from] = stamp;
+        queue.emplace_back(Weight{}, from);
+
+        while (!queue.empty())
+        {
+            std::pop_heap(queue.begin(), queue.end(), later);
+            const auto [distance, vertex] = queue.back();
+            queue.pop_back();
+
+            if (distance > distances[vertex])
+            {
+                continue;
+            }
+
+            if (vertex == to)
+            {
+                std::vector<EdgeId> edges;
+
+                for (VertexId current = to; current != from; current = graph.GetEdge(edges.back()).from)
+                {
+                    edges.push_back(prev_edges[current]);
+                }
+
+                std::reverse(edges.begin(), edges.end());
+
+                return typename Router<Weight>::RouteInfo{distance, std::move(edges)};
+            }
+
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
+            {
+                const auto &edge = graph.GetEdge(edge_id);
+                const Weight candidate = distance + edge.weight;
+
+                if (banned_edge_stamps[edge_id] == ban_stamp || banned_vertex_stamps[edge.to] == ban_stamp ||
+                    candidate > budget || (reached(edge.to) && !(candidate < distances[edge.to])))
+                {
+                    continue;
+                }
+
+                distances[edge.to] = candidate;
+                distance_stamps[edge.to] = stamp;
+                prev_edges[edge.to] = edge_id;
+                queue.emplace_back(candidate, edge.to);
+                std::push_heap(queue.begin(), queue.end(), later);
+            }
+        }
+
+        return std::nullopt;
+    }
+};
+} // namespace detail
+
+/*
+    До count простых (без повторных вершин) путей from -> to по возрастанию веса (алгоритм Йена).
+    Рассматриваются только пути не тяжелее max_stretch * вес кратчайшего: это ограничивает
+    и ответ, и каждый вспомогательный поиск от точки ответвления.
+*/
+template <typename Weight>
+std::vector<typename Router<Weight>::RouteInfo> FindAlternativeRoutes(const DirectedWeightedGraph<Weight> &graph,
+                                                                      VertexId from, VertexId to, size_t count,
+                                                                      double max_stretch)
+{
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    if (from >= graph.GetVertexCount() || to >= graph.GetVertexCount())
+    {
+        throw std::out_of_range("vertex is out of range");
+    }
+
+    thread_local detail::AlternativeSearchState<Weight> state;
+    state.Prepare(graph.GetVertexCount(), graph.GetEdgeCount());
+    state.NewBans();
+
+    std::vector<RouteInfo> routes;
+    const auto shortest = state.FindPath(graph, from, to, std::numeric_limits<Weight>::max());
+
+    if (!shortest || count == 0)
+    {
+        return routes;
+    }
+
+    const Weight budget = static_cast<Weight>(shortest->weight * max_stretch);
+    // Кандидаты упорядочены по весу, затем по рёбрам — одинаковые пути не дублируются
+    std::set<std::pair<Weight, std::vector<EdgeId>>> candidates;
+    routes.push_back(*shortest);
+
+    while (routes.size() < count)
+    {
+        const RouteInfo &last = routes.back();
+        VertexId spur_vertex = from;
+        Weight root_weight{};
+
+        for (size_t spur = 0; spur < last.edges.size(); ++spur)
+        {
+            state.NewBans();
+
+            // Продолжение уже найденных путей с тем же началом запрещено
+            for (const RouteInfo &route : routes)
+            {
+                if (route.edges.size() > spur && std::equal(last.edges.begin(), last.edges.begin() + spur,
+                                                            route.edges.begin()))
+                {
+                    state.banned_edge_stamps[route.edges[spur]] = state.ban_stamp;
+                }
+            }
+
+            // Вершины общего начала запрещены, чтобы путь остался простым
+            VertexId root_vertex = from;
+
+            for (size_t i = 0; i < spur; ++i)
+            {
+                state.banned_vertex_stamps[root_vertex] = state.ban_stamp;
+                root_vertex = graph.GetEdge(last.edges[i]).to;
+            }
+
+            if (auto spur_path = state.FindPath(graph, spur_vertex, to, budget - root_weight))
+            {
+                std::vector<EdgeId> edges(last.edges.begin(), last.edges.begin() + spur);
+                edges.insert(edges.end(), spur_path->edges.begin(), spur_path->edges.end());
+                candidates.emplace(root_weight + spur_path->weight, std::move(edges));
+            }
+
+            const auto &edge = graph.GetEdge(last.edges[spur]);
+            root_weight += edge.weight;
+            spur_vertex = edge.to;
+        }
+
+        // Кандидат мог совпасть с уже выбранным путём, если его нашли от разных точек ответвления
+        while (!candidates.empty() &&
+               std::any_of(routes.begin(), routes.end(),
+                           [&](const RouteInfo &route) { return route.edges == candidates.begin()->second; }))
+        {
+            candidates.erase(candidates.begin());
+        }
+
+        if (candidates.empty())
+        {
+            break;
+        }
+
+        routes.push_back({candidates.begin()->first, candidates.begin()->second});
+        candidates.erase(candidates.begin());
+    }
+
+    return routes;
+}
+} // namespace graph
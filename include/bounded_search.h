@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+namespace graph
+{
+/*
+    Ограниченный алгоритм Дейкстры: вершины, достижимые из from с весом пути не больше budget.
+    Рабочие массивы живут в thread_local и после запроса восстанавливаются только в тех ячейках,
+    которых коснулся поиск, поэтому стоимость запроса пропорциональна достигнутой области графа.
+*/
+template <typename Weight>
+std::vector<std::pair<VertexId, Weight>> FindReachable(const DirectedWeightedGraph<Weight> &graph, VertexId from,
+                                                       Weight budget)
+{
+    static constexpr Weight UNREACHED = std::numeric_limits<Weight>::max();
+
+    struct Scratch
+    {
+        std::vector<Weight> distances;
+        std::vector<VertexId> touched;
+        std::vector<std::pair<Weight, VertexId>> queue;
+    };
+
+    thread_local Scratch scratch;
+
+    if (from >= graph.GetVertexCount())
+    {
+        throw std::out_of_range("vertex is out of range");
+    }
+
+    if (scratch.distances.size() < graph.GetVertexCount())
+    {
+        scratch.distances.resize(graph.GetVertexCount(), UNREACHED);
+    }
+
+    auto &distances = scratch.distances;
+    auto &queue = scratch.queue;
+    const std::greater<std::pair<Weight, VertexId>> later;
+    std::vector<std::pair<VertexId, Weight>> reached;
+
+    distances[from] = Weight{};
+    scratch.touched.push_back(from);
+    queue.emplace_back(Weight{}, from);
+
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), later);
+        const auto [distance, vertex] = queue.back();
+        queue.pop_back();
+
+        // Устаревшая запись: вершину уже достали с меньшим весом
+        if (distance > distances[vertex])
+        {
+            continue;
+        }
+
+        reached.emplace_back(vertex, distance);
+
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
+        {
+            const auto &edge = graph.GetEdge(edge_id);
+            const Weight candidate = distance + edge.weight;
+
+            if (candidate > budget || !(candidate < distances[edge.to]))
+            {
+                continue;
+            }
+
+            if (distances[edge.to] == UNREACHED)
+            {
+                scratch.touched.push_back(edge.to);
+            }
+
+            distances[edge.to] = candidate;
+            queue.emplace_back(candidate, edge.to);
+            std::push_heap(queue.begin(), queue.end(), later);
+        }
+    }
+
+    for (const VertexId vertex : scratch.touched)
+    {
+        distances[vertex] = UNREACHED;
+    }
+
+    scratch.touched.clear();
+
+    return reached;
+}
+} // namespace graph
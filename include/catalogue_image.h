@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "graph.h"
+#include "router.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+/*
+    CatalogueImage — образ справочника и таблицы маршрутов в виде одного файла,
+    отображаемого в память только для чтения. Все ссылки внутри файла задаются
+    смещениями от его начала, поэтому несколько процессов могут отображать один
+    и тот же файл и разделять его страницы через кэш страниц ОС.
+    Новая версия образа пишется во временный файл и атомарно заменяет старую
+    через rename(): уже отображённые копии остаются валидными до перезагрузки.
+*/
+
+namespace image
+{
+inline constexpr char MAGIC[8] = {'T', 'C', 'I', 'M', 'A', 'G', 'E', '\0'};
+inline constexpr uint32_t VERSION = 6;
+inline constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+struct Section
+{
+    uint64_t offset; // Смещение от начала файла
+    uint64_t count;  // Количество записей
+};
+
+struct StringRef
+{
+    uint64_t offset; // Смещение внутри секции строк
+    uint64_t length;
+};
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    int32_t bus_wait_time;
+    uint64_t checksum; // FNV-1a файла до таблицы маршрутов; само поле считается нулевым
+    double bus_velocity;
+    uint64_t build_threads;
+    uint64_t vertex_count;
+    uint64_t log_generation; // Поколение журнала изменений на момент снимка
+    uint64_t log_records;    // Сколько первых записей этого поколения уже учтено в снимке
+    uint32_t route_engine;     // tc::RouteEngine
+    uint32_t timetable_engine; // tc::TimetableEngine
+    uint64_t landmark_count;
+    uint64_t cell_size;
+    double walk_speed;
+    uint64_t walk_stop_count;
+    double walk_radius;
+    StringRef render_settings; // JSON-документ вида {"render_settings": {...}}
+    Section strings;
+    Section stops;
+    Section buses;
+    Section bus_stops;
+    Section distances;
+    Section schedules;
+    Section edges;
+    Section routes;
+};
+
+struct StopRecord
+{
+    StringRef name;
+    double lat;
+    double lng;
+};
+
+struct BusRecord
+{
+    StringRef number;
+    uint32_t stops_begin; // Индекс первой остановки в секции bus_stops
+    uint32_t stops_count;
+    uint32_t is_roundtrip;
+    uint32_t reserved;
+};
+
+struct DistanceRecord // Отсортированы по (from, to)
+{
+    uint32_t from;
+    uint32_t to;
+    int32_t distance;
+    uint32_t reserved;
+};
+
+struct ScheduleRecord // Интервал движения автобуса; интервалы одного автобуса идут подряд в прежнем порядке
+{
+    StringRef bus;
+    double from;
+    double to;
+    double interval;
+};
+
+struct EdgeRecord
+{
+    StringRef name;
+    uint32_t span_count;
+    int32_t distance; // Длина в метрах; у рёбер ожидания 0
+    uint32_t from;
+    uint32_t to;
+    double weight;
+};
+
+struct RouteCell // Ячейка таблицы маршрутов vertex_count x vertex_count; таблица есть только у RouteEngine::ALL_PAIRS
+{
+    double weight;
+    uint32_t prev_edge; // NO_INDEX, если маршрут состоит из одной вершины
+    uint32_t has_route;
+};
+
+class CatalogueImage
+{
+  public:
+    explicit CatalogueImage(const std::string &path);
+    CatalogueImage(const CatalogueImage &) = delete;
+    CatalogueImage &operator=(const CatalogueImage &) = delete;
+    ~CatalogueImage();
+
+    const std::string &GetPath() const;
+    size_t GetStopCount() const;
+    std::string_view GetStopName(size_t index) const;
+    size_t GetVertexCount() const;
+    tc::RoutingSettings GetRoutingSettings() const;
+    std::string_view GetRenderSettings() const;
+    uint64_t GetLogGeneration() const;
+    uint64_t GetLogRecords() const;
+
+    void FillTransportCatalogue(tc::TransportCatalogue &catalogue) const;
+    graph::DirectedWeightedGraph<double> MakeGraph() const;
+    std::vector<int> GetEdgeDistances() const;
+    bool HasRouteTable() const;
+    // Строка таблицы маршрутов из вершины from: vertex_count ячеек
+    const RouteCell *GetRouteRow(graph::VertexId from) const;
+    std::optional<graph::Router<double>::RouteInfo> BuildRoute(graph::VertexId from, graph::VertexId to) const;
+    std::optional<double> GetRouteWeight(graph::VertexId from, graph::VertexId to) const;
+
+  private:
+    void Validate() const;
+    template <typename T> const T *GetSection(const Section &section) const;
+    std::string_view GetString(const StringRef &ref) const;
+
+    std::string path_;
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    const Header *header_ = nullptr;
+};
+
+// Записывает образ во временный файл рядом с path и атомарно переименовывает его в path
+void WriteImage(const std::string &path, const tc::TransportCatalogue &catalogue, const tc::TransportRouter &router,
+                std::string_view render_settings, uint64_t log_generation = 0, uint64_t log_records = 0);
+// Атомарно заменяет файл path образом из tmp_path; переименование сохраняется на диске до возврата
+void ReplaceImage(const std::string &tmp_path, const std::string &path);
+} // namespace image
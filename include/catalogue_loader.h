@@ -0,0 +1,42 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <string>
+
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+/*
+    LoadCatalogue — конвейерная загрузка справочника:
+    * разбор JSON передаёт элементы base_requests построителю справочника через ограниченную очередь;
+    * параметры отрисовки и маршрутизации читаются, пока построитель дописывает расстояния и маршруты;
+    * маршрутизатор и предварительная отрисовка карты строятся параллельно.
+*/
+
+namespace loader
+{
+struct LoadTimings // Время каждой стадии в миллисекундах, стадии частично перекрываются
+{
+    double parse = 0.0;
+    double build = 0.0;
+    double settings = 0.0;
+    double router = 0.0;
+    double map = 0.0;
+    double total = 0.0;
+};
+
+struct LoadResult
+{
+    std::unique_ptr<tc::TransportCatalogue> catalogue;
+    std::unique_ptr<json_reader::JsonReader> json_reader;
+    std::unique_ptr<renderer::MapRenderer> renderer;
+    std::unique_ptr<tc::TransportRouter> router;
+    std::string map_svg;
+    LoadTimings timings;
+};
+
+LoadResult LoadCatalogue(std::istream &input, size_t queue_capacity = 1024);
+} // namespace loader
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "timetable.h"
+
+/*
+    ConnectionScan — поиск самого раннего прибытия алгоритмом CSA (Connection Scan).
+    Расписание разворачивается в элементарные связи «отправление с остановки — прибытие на следующую»
+    для каждого рейса каждой линии. Связи лежат в отдельных массивах по полям (structure of arrays),
+    отсортированных по времени отправления, поэтому запрос — один линейный проход по непрерывной памяти,
+    который заканчивается, как только отправления становятся позже уже найденного прибытия.
+*/
+
+namespace timetable
+{
+class ConnectionScan
+{
+  public:
+    explicit ConnectionScan(const Timetable &timetable);
+
+    size_t GetConnectionCount() const;
+    std::optional<Journey> FindEarliestArrival(const tc::Stop *from, const tc::Stop *to, double depart_at) const;
+
+  private:
+    const Timetable &timetable_;
+
+    // Связь i: рейс trips_[i] отправляется с остановки departure_stops_[i] в departure_times_[i]
+    // и прибывает на arrival_stops_[i] в arrival_times_[i]; positions_[i] — номер связи внутри рейса
+    std::vector<double> departure_times_;
+    std::vector<double> arrival_times_;
+    std::vector<uint32_t> departure_stops_;
+    std::vector<uint32_t> arrival_stops_;
+    std::vector<uint32_t> trips_;
+    std::vector<uint32_t> positions_;
+
+    std::vector<uint32_t> trip_lines_; // Линия каждого рейса
+};
+} // namespace timetable
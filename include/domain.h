@@ -1,7 +1,7 @@
 #pragma once
 
 #include "geo.h"
-#include <set>
+#include "name_pool.h"
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -10,18 +10,27 @@ namespace tc
 {
 struct Stop
 {
-    std::string name;
+    names::Name name;
     geo::Coordinates coordinates;
-    std::set<std::string> buses;
+    std::vector<names::Name> buses; // Автобусы через остановку, по возрастанию номера, без повторов
+    geo::SpherePoint sphere_point = {}; // Заполняется по coordinates в TransportCatalogue::AddStop
 };
 
 struct Bus
 {
-    std::string number;
+    names::Name number;
     std::vector<const Stop *> stops;
     bool is_roundtrip;
 };
 
+// Интервал движения: с from до to (минуты от полуночи) автобус отправляется с начальной остановки каждые interval минут
+struct Headway
+{
+    double from = 0.0;
+    double to = 0.0;
+    double interval = 0.0;
+};
+
 struct BusStat
 {
     size_t total_stops = 0;
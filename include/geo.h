@@ -1,9 +1,13 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include <vector>
 
 namespace geo
 {
+inline constexpr double EARTH_RADIUS = 6371000;
+
 struct Coordinates
 {
     double lat;
@@ -20,5 +24,50 @@ struct Coordinates
     }
 };
 
+// Точка как единичный вектор на сфере: синусы и косинусы считаются один раз при создании
+struct SpherePoint
+{
+    double x = 0.0;
+    double y = 0.0;
+    double z = 1.0;
+};
+
 double ComputeDistance(Coordinates from, Coordinates to);
+SpherePoint ToSpherePoint(Coordinates point);
+// Расстояние между заранее подготовленными точками: на коротких дугах — без тригонометрии,
+// с той же точностью, что у CoordinateBatch
+double ComputeDistance(const SpherePoint &from, const SpherePoint &to);
+// Длина хорды единичной сферы для дуги distance метров
+double DistanceToChord(double distance);
+
+/*
+    CoordinateBatch — пакетный расчёт расстояний. Каждая точка один раз переводится в единичный вектор
+    (x, y, z), векторы лежат в отдельных непрерывных массивах. Расстояние считается по хорде c = |p - q|:
+    дуга 2 * asin(c / 2) = c + c^3 / 24 + 3c^5 / 640 + 5c^7 / 7168 + ...
+    Для хорд до MAX_SERIES_CHORD (около 640 км) ряд обрывается после c^7, относительная погрешность
+    обрыва не больше 1.3e-12; более длинные хорды досчитываются точным asin.
+    Основной цикл — только арифметика и sqrt без ветвлений, поэтому компилятор его векторизует.
+*/
+class CoordinateBatch
+{
+  public:
+    static constexpr double MAX_SERIES_CHORD = 0.1;
+
+    CoordinateBatch() = default;
+    explicit CoordinateBatch(const std::vector<Coordinates> &points);
+
+    void Add(Coordinates point);
+    void Add(const SpherePoint &point);
+    size_t GetSize() const;
+    // distances[i] — расстояние от point до i-й точки пакета
+    void ComputeDistancesTo(Coordinates point, std::vector<double> &distances) const;
+    void ComputeDistancesTo(const SpherePoint &point, std::vector<double> &distances) const;
+    // distances[i] — расстояние от i-й до (i + 1)-й точки, для длины ломаной
+    void ComputeSegmentDistances(std::vector<double> &distances) const;
+
+  private:
+    std::vector<double> x_;
+    std::vector<double> y_;
+    std::vector<double> z_;
+};
 } // namespace geo
\ No newline at end of file
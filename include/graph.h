@@ -3,6 +3,7 @@
 #include <cstdlib>
 #include <vector>
 
+#include "name_pool.h"
 #include "ranges.h"
 
 /*
@@ -22,7 +23,7 @@ using EdgeId = size_t;
 
 template <typename Weight> struct Edge // "Набор" рёбер
 {
-    std::string name;  // Название остановки или номер автобуса
+    names::Name name;  // Название остановки или номер автобуса
     size_t span_count; // Колличество перегонов между остановками
     VertexId from;     // Вершина ребра "из"
     VertexId to;       // Вершина ребра "до"
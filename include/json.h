@@ -1,8 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
-#include <map>
+#include <memory_resource>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -12,8 +18,57 @@ namespace json
 {
 class Node;
 
-using Dict = std::map<std::string, Node>;
-using Array = std::vector<Node>;
+// Массивы и словари берут память у memory_resource, переданного при разборе. Копия узла всегда
+// выделяет память в обычной куче, поэтому её можно хранить дольше буфера разобранного документа
+using Array = std::pmr::vector<Node>;
+
+/*
+    Dict — пары (ключ, значение) в непрерывном массиве, отсортированном по ключу, с интерфейсом std::map.
+    В объектах JSON обычно меньше десятка ключей: двоичный поиск по массиву обходится без переходов
+    по узлам дерева, а порядок обхода и вывода тот же, что у std::map.
+    Вставка и удаление сдвигают элементы и делают недействительными ссылки на значения.
+*/
+class Dict
+{
+  public:
+    using value_type = std::pair<std::string, Node>;
+    using iterator = std::pmr::vector<value_type>::iterator;
+    using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+    Dict() = default;
+    explicit Dict(std::pmr::memory_resource *resource);
+    Dict(std::initializer_list<value_type> items);
+    // Сортирует пары по ключу; повторённый ключ — ParsingError, как при разборе документа
+    explicit Dict(std::pmr::vector<value_type> items);
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    Node &at(std::string_view key);
+    const Node &at(std::string_view key) const;
+    Node &operator[](std::string key);
+
+    // Как у std::map: если ключ уже есть, словарь не меняется
+    std::pair<iterator, bool> emplace(std::string key, Node value);
+    std::pair<iterator, bool> insert(value_type item);
+    size_t erase(std::string_view key);
+    iterator erase(const_iterator position);
+
+    bool operator==(const Dict &rhs) const;
+    bool operator!=(const Dict &rhs) const;
+
+  private:
+    const_iterator LowerBound(std::string_view key) const;
+
+    std::pmr::vector<value_type> items_;
+};
 
 class ParsingError : public std::runtime_error
 {
@@ -82,6 +137,157 @@ class Node final : private std::variant<std::nullptr_t, Array, Dict, bool, int,
     // Value value_;
 };
 
+inline Dict::Dict(std::pmr::memory_resource *resource) : items_(resource)
+{
+}
+
+inline Dict::Dict(std::initializer_list<value_type> items)
+{
+    items_.reserve(items.size());
+
+    for (const auto &item : items)
+    {
+        insert(item);
+    }
+}
+
+inline Dict::Dict(std::pmr::vector<value_type> items) : items_(std::move(items))
+{
+    // Равных ключей после проверки нет, поэтому устойчивая сортировка с её временным буфером не нужна
+    std::sort(items_.begin(), items_.end(),
+              [](const value_type &lhs, const value_type &rhs) { return lhs.first < rhs.first; });
+
+    const auto duplicate = std::adjacent_find(
+        items_.begin(), items_.end(), [](const value_type &lhs, const value_type &rhs) { return lhs.first == rhs.first; });
+
+    if (duplicate != items_.end())
+    {
+        throw ParsingError("Duplicate key '" + duplicate->first + "' have been found");
+    }
+}
+
+inline Dict::iterator Dict::begin()
+{
+    return items_.begin();
+}
+
+inline Dict::iterator Dict::end()
+{
+    return items_.end();
+}
+
+inline Dict::const_iterator Dict::begin() const
+{
+    return items_.begin();
+}
+
+inline Dict::const_iterator Dict::end() const
+{
+    return items_.end();
+}
+
+inline size_t Dict::size() const
+{
+    return items_.size();
+}
+
+inline bool Dict::empty() const
+{
+    return items_.empty();
+}
+
+inline Dict::const_iterator Dict::LowerBound(std::string_view key) const
+{
+    return std::lower_bound(items_.begin(), items_.end(), key,
+                            [](const value_type &item, std::string_view key) { return item.first < key; });
+}
+
+inline Dict::const_iterator Dict::find(std::string_view key) const
+{
+    const auto it = LowerBound(key);
+
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+inline Dict::iterator Dict::find(std::string_view key)
+{
+    return items_.begin() + (std::as_const(*this).find(key) - items_.cbegin());
+}
+
+inline size_t Dict::count(std::string_view key) const
+{
+    return find(key) != items_.end() ? 1 : 0;
+}
+
+inline const Node &Dict::at(std::string_view key) const
+{
+    const auto it = find(key);
+
+    if (it == items_.end())
+    {
+        // Тот же текст, что у std::map::at: он попадает в ответы об ошибках
+        throw std::out_of_range("map::at");
+    }
+
+    return it->second;
+}
+
+inline Node &Dict::at(std::string_view key)
+{
+    return const_cast<Node &>(std::as_const(*this).at(key));
+}
+
+inline Node &Dict::operator[](std::string key)
+{
+    return emplace(std::move(key), Node{}).first->second;
+}
+
+inline std::pair<Dict::iterator, bool> Dict::emplace(std::string key, Node value)
+{
+    return insert({std::move(key), std::move(value)});
+}
+
+inline std::pair<Dict::iterator, bool> Dict::insert(value_type item)
+{
+    const auto position = LowerBound(item.first);
+
+    if (position != items_.end() && position->first == item.first)
+    {
+        return {items_.begin() + (position - items_.cbegin()), false};
+    }
+
+    return {items_.insert(position, std::move(item)), true};
+}
+
+inline size_t Dict::erase(std::string_view key)
+{
+    const auto it = find(key);
+
+    if (it == items_.end())
+    {
+        return 0;
+    }
+
+    items_.erase(it);
+
+    return 1;
+}
+
+inline Dict::iterator Dict::erase(const_iterator position)
+{
+    return items_.erase(position);
+}
+
+inline bool Dict::operator==(const Dict &rhs) const
+{
+    return items_ == rhs.items_;
+}
+
+inline bool Dict::operator!=(const Dict &rhs) const
+{
+    return !(*this == rhs);
+}
+
 class Document
 {
   public:
@@ -110,7 +316,14 @@ class Document
     Node root_;
 };
 
-Document Load(std::istream &input);
+// Узлы документа выделяются в resource; документ не должен жить дольше resource
+Document Load(std::istream &input, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+// Разбирает документ-словарь, передавая элементы массива по ключу array_key в on_item по мере чтения.
+// В возвращаемом документе этот массив остаётся пустым
+Document LoadStreaming(std::istream &input, const std::string &array_key, const std::function<void(Node)> &on_item);
 
 void Print(const Document &doc, std::ostream &output);
+// Выводит узел, вложенный с отступом indent: первая строка без отступа, следующие — с отступом уровня узла
+void PrintNode(const Node &node, std::ostream &output, int indent);
 } // end namespace json
\ No newline at end of file
@@ -7,6 +7,11 @@
 
 namespace json_reader
 {
+// Допустимое удлинение альтернативного маршрута относительно кратчайшего, если max_stretch не задан
+inline constexpr double DEFAULT_MAX_STRETCH = 1.5;
+// С меньшим числом различных запросов в пакете рабочие потоки не запускаются
+inline constexpr size_t PARALLEL_MIN_REQUEST_COUNT = 64;
+
 struct CommandDescription
 {
 
@@ -28,10 +33,16 @@ struct CommandDescription
 class JsonReader
 {
   public:
-    JsonReader(std::istream &document) : document_(json::Load(document))
+    JsonReader() = default;
+
+    // Узлы документа выделяются в resource, который должен жить дольше JsonReader
+    JsonReader(std::istream &document, std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : document_(json::Load(document, resource))
     {
     }
 
+    void SetDocument(json::Document document);
+
     const json::Node &GetBaseRequests() const;
     const json::Node &GetStatRequests() const;
     const json::Node &GetRenderSettings() const;
@@ -42,6 +53,18 @@ class JsonReader
     const json::Node PrintMap(const json::Dict &request, RequestHandler &request_handler) const;
     const json::Node PrintRoute(const json::Dict &request, tc::TransportCatalogue &catalogue_,
                                 RequestHandler &request_handler) const;
+    // Матрица времён в пути между sources и targets; с with_items — ещё и маршруты
+    const json::Node PrintRouteMatrix(const json::Dict &request, tc::TransportCatalogue &catalogue_,
+                                      RequestHandler &request_handler) const;
+    // Остановки, достижимые из from за max_time минут, с временем прибытия
+    const json::Node PrintReachable(const json::Dict &request, tc::TransportCatalogue &catalogue_,
+                                    RequestHandler &request_handler) const;
+    // До count ближайших к точке (latitude, longitude) остановок с расстоянием в метрах
+    const json::Node PrintNearest(const json::Dict &request, tc::TransportCatalogue &catalogue_) const;
+    // Остановки не дальше radius метров от точки (latitude, longitude)
+    const json::Node PrintStopsInRadius(const json::Dict &request, tc::TransportCatalogue &catalogue_) const;
+    // Остановки, у которых одно из слов названия начинается с query, с опечатками и постранично
+    const json::Node PrintStopSearch(const json::Dict &request, tc::TransportCatalogue &catalogue_) const;
     void ProcessRequests(const json::Node &stat_requests, tc::TransportCatalogue &catalogue,
                          RequestHandler &request_handler, std::ostream &output) const;
     void FillTransportCatalogue(tc::TransportCatalogue &catalogue);
@@ -49,15 +72,50 @@ class JsonReader
     tc::RoutingSettings FillRoutingSettings(const json::Node &settings) const;
     void ApplyCommands(tc::TransportCatalogue &catalogue) const;
     void ParseRequest(const json::Node &request);
+    // Потоковое заполнение: остановка добавляется сразу, расстояния и маршруты — в FinishTransportCatalogue
+    void AddBaseRequest(const json::Node &request, tc::TransportCatalogue &catalogue);
+    void FinishTransportCatalogue(tc::TransportCatalogue &catalogue) const;
 
   private:
+    json::Node MakeStopDistances(int id, const spatial::StopIndex::StopDistances &stops) const;
+    // Ответ на один запрос; std::nullopt для запроса неизвестного типа
+    std::optional<json::Node> ProcessRequest(const json::Dict &request, tc::TransportCatalogue &catalogue,
+                                             RequestHandler &request_handler) const;
     tc::Stop MakeStop(const json_reader::CommandDescription &c) const;
     tc::Bus MakeBus(const json_reader::CommandDescription &c, tc::TransportCatalogue &catalogue) const;
     void ProcessColors(const json::Dict &request, renderer::RenderSettings &render_settings) const;
     svg::Rgb MakeRGB(const json::Array &type) const;
     svg::Rgba MakeRGBA(const json::Array &type) const;
     void AddDistance(const json_reader::CommandDescription &c, tc::TransportCatalogue &catalogue) const;
+    // Ответ на запрос Route с depart_at: самое раннее прибытие по расписанию
+    const json::Node PrintTimedRoute(const json::Dict &request, const tc::Stop *from, const tc::Stop *to,
+                                     RequestHandler &request_handler) const;
+    // Ответ на запрос Route с max_transfers: множество Парето по времени и числу пересадок
+    const json::Node PrintParetoRoute(const json::Dict &request, const tc::Stop *from, const tc::Stop *to,
+                                      RequestHandler &request_handler) const;
+    // Ответ на запрос Route с alternatives: до k простых маршрутов не длиннее max_stretch * кратчайший
+    const json::Node PrintAlternativeRoutes(const json::Dict &request, const tc::Stop *from, const tc::Stop *to,
+                                            RequestHandler &request_handler) const;
+    // Ответ на запрос Route с from_point или to_point: пешком до одной из ближайших остановок, дальше по графу
+    const json::Node PrintPointRoute(const json::Dict &request, tc::TransportCatalogue &catalogue_,
+                                     RequestHandler &request_handler) const;
+    // Элементы Wait и Bus маршрута по расписанию
+    json::Array MakeJourneyItems(const timetable::Journey &journey) const;
+    // Напечатанный ответ на запрос Route между остановками из кэша или, при промахе, построенный и добавленный в кэш;
+    // null, если текст ответа не делится по request_id
+    std::shared_ptr<const cache::PrintedAnswer> GetRouteAnswer(const tc::Stop *from, const tc::Stop *to,
+                                                               RequestHandler &request_handler) const;
+    // Ответ на запрос Route без request_id; null, если маршрута нет
+    json::Node MakeRouteAnswer(const tc::Stop *from, const tc::Stop *to, RequestHandler &request_handler) const;
+    // total_time и items маршрута по рёбрам графа
+    json::Node MakeRouteBody(const std::vector<graph::EdgeId> &edges, RequestHandler &request_handler) const;
+    json::Array MakeRouteItems(const std::vector<graph::EdgeId> &edges, RequestHandler &request_handler) const;
+    // Элемент Walk; from и to — остановки начала и конца пути пешком, nullptr для точки
+    json::Node MakeWalkItem(const tc::Stop *from, const tc::Stop *to, double time) const;
+    // Запрос Route между двумя остановками без дополнительных условий: его ответ кэшируется
+    static bool IsStopRoute(const json::Dict &request);
     static CommandDescription ParseCommandDescription(const json::Node &request);
+    static geo::Coordinates ParsePoint(const json::Node &point);
     static std::vector<const tc::Stop *> ParseRoute(const json::Dict &description, tc::TransportCatalogue &catalogue);
 
     json::Document document_;
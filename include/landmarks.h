@@ -0,0 +1,334 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "parallel.h"
+#include "router.h"
+
+namespace graph
+{
+namespace detail
+{
+// Дейкстра от source по дугам, которые перечисляет for_each_arc(vertex, relax(to, weight))
+template <typename Weight, typename Arcs>
+std::vector<Weight> ComputeDistances(size_t vertex_count, VertexId source, Arcs for_each_arc)
+{
+    std::vector<Weight> distances(vertex_count, std::numeric_limits<Weight>::infinity());
+    std::vector<std::pair<Weight, VertexId>> queue{{Weight{}, source}};
+    const std::greater<std::pair<Weight, VertexId>> later;
+    distances[source] = Weight{};
+
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), later);
+        const auto [distance, vertex] = queue.back();
+        queue.pop_back();
+
+        if (distance > distances[vertex])
+        {
+            continue;
+        }
+
+        for_each_arc(vertex, [&](VertexId to, Weight weight) {
+            if (distance + weight < distances[to])
+            {
+                distances[to] = distance + weight;
+                queue.emplace_back(distances[to], to);
+                std::push_heap(queue.begin(), queue.end(), later);
+            }
+        });
+    }
+
+    return distances;
+}
+} // namespace detail
+
+/*
+    LandmarkIndex — предрасчёт для ALT (A* с ориентирами и неравенством треугольника).
+    Ориентиры выбираются жадно среди кандидатов: каждый следующий — самый далёкий от уже выбранных.
+    Для ориентира L хранятся d(L, v) и d(v, L) для всех вершин, тогда для любых from, to
+    d(from, to) >= d(L, to) - d(L, from) и d(from, to) >= d(from, L) - d(to, L).
+    Расстояния хранятся во float подряд по вершинам: оценка для вершины читает одну короткую строку памяти.
+*/
+template <typename Weight> class LandmarkIndex
+{
+    static_assert(std::is_floating_point_v<Weight>, "landmark bounds need floating point weights");
+
+  public:
+    LandmarkIndex(const DirectedWeightedGraph<Weight> &graph, const std::vector<VertexId> &candidates,
+                  size_t landmark_count, size_t thread_count);
+
+    // Нижняя оценка веса пути from -> to; бесконечность, если пути точно нет
+    Weight GetLowerBound(VertexId from, VertexId to) const;
+    const std::vector<VertexId> &GetLandmarks() const;
+
+  private:
+    std::vector<VertexId> landmarks_;
+    std::vector<float> distances_from_; // [vertex * число ориентиров + i] — от ориентира i до vertex
+    std::vector<float> distances_to_;   // [vertex * число ориентиров + i] — от vertex до ориентира i
+};
+
+template <typename Weight>
+LandmarkIndex<Weight>::LandmarkIndex(const DirectedWeightedGraph<Weight> &graph,
+                                     const std::vector<VertexId> &candidates, size_t landmark_count,
+                                     size_t thread_count)
+{
+    const size_t vertex_count = graph.GetVertexCount();
+
+    auto forward_arcs = [&graph](VertexId vertex, auto relax) {
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
+        {
+            relax(graph.GetEdge(edge_id).to, graph.GetEdge(edge_id).weight);
+        }
+    };
+
+    // Обратные дуги в сжатом виде: входящие рёбра вершины v — reverse_edges[reverse_offsets[v]..reverse_offsets[v + 1])
+    std::vector<size_t> reverse_offsets(vertex_count + 1, 0);
+    std::vector<EdgeId> reverse_edges(graph.GetEdgeCount());
+
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id)
+    {
+        ++reverse_offsets[graph.GetEdge(edge_id).to + 1];
+    }
+
+    std::partial_sum(reverse_offsets.begin(), reverse_offsets.end(), reverse_offsets.begin());
+
+    {
+        std::vector<size_t> positions(reverse_offsets.begin(), reverse_offsets.end() - 1);
+
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id)
+        {
+            reverse_edges[positions[graph.GetEdge(edge_id).to]++] = edge_id;
+        }
+    }
+
+    auto backward_arcs = [&](VertexId vertex, auto relax) {
+        for (size_t i = reverse_offsets[vertex]; i < reverse_offsets[vertex + 1]; ++i)
+        {
+            relax(graph.GetEdge(reverse_edges[i]).from, graph.GetEdge(reverse_edges[i]).weight);
+        }
+    };
+
+    // Самая далёкая от уже выбранных ориентиров вершина-кандидат. Недостижимые не выбираются,
+    // иначе ориентиры уходят на изолированные остановки
+    auto find_farthest = [&candidates](const std::vector<Weight> &distances) {
+        std::optional<VertexId> farthest;
+
+        for (const VertexId candidate : candidates)
+        {
+            if (distances[candidate] != std::numeric_limits<Weight>::infinity() && distances[candidate] > Weight{} &&
+                (!farthest || distances[candidate] > distances[*farthest]))
+            {
+                farthest = candidate;
+            }
+        }
+
+        return farthest;
+    };
+
+    std::vector<std::vector<Weight>> forward;
+    std::vector<Weight> nearest(vertex_count, std::numeric_limits<Weight>::infinity());
+    std::optional<VertexId> next;
+
+    // Первый ориентир — самый далёкий от произвольного кандидата
+    if (!candidates.empty() && landmark_count > 0)
+    {
+        next = find_farthest(detail::ComputeDistances<Weight>(vertex_count, candidates.front(), forward_arcs))
+                   .value_or(candidates.front());
+    }
+
+    while (next && landmarks_.size() < landmark_count)
+    {
+        landmarks_.push_back(*next);
+        forward.push_back(detail::ComputeDistances<Weight>(vertex_count, *next, forward_arcs));
+
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+        {
+            nearest[vertex] = std::min(nearest[vertex], forward.back()[vertex]);
+        }
+
+        next = find_farthest(nearest);
+    }
+
+    const size_t count = landmarks_.size();
+    distances_from_.resize(vertex_count * count);
+    distances_to_.resize(vertex_count * count);
+
+    // Обратные поиски независимы друг от друга
+    parallel::ParallelFor(
+        count, thread_count,
+        [&](size_t i) {
+            const auto backward = detail::ComputeDistances<Weight>(vertex_count, landmarks_[i], backward_arcs);
+
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+            {
+                distances_from_[vertex * count + i] = static_cast<float>(forward[i][vertex]);
+                distances_to_[vertex * count + i] = static_cast<float>(backward[vertex]);
+            }
+        },
+        1);
+}
+
+template <typename Weight> Weight LandmarkIndex<Weight>::GetLowerBound(VertexId from, VertexId to) const
+{
+    constexpr Weight UNREACHED = std::numeric_limits<Weight>::infinity();
+    // Погрешность округления до float: оценка уменьшается на неё, чтобы не превысить настоящий вес
+    constexpr Weight ROUNDING = std::numeric_limits<float>::epsilon();
+
+    const size_t count = landmarks_.size();
+    const float *from_landmark = distances_from_.data();
+    const float *to_landmark = distances_to_.data();
+    Weight bound{};
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Weight landmark_from = from_landmark[from * count + i];
+        const Weight landmark_to = from_landmark[to * count + i];
+        const Weight from_to_landmark = to_landmark[from * count + i];
+        const Weight to_to_landmark = to_landmark[to * count + i];
+
+        // Из ориентира есть путь до from, но нет до to — значит, и из from нет пути до to
+        if ((landmark_from != UNREACHED && landmark_to == UNREACHED) ||
+            (from_to_landmark == UNREACHED && to_to_landmark != UNREACHED))
+        {
+            return UNREACHED;
+        }
+
+        if (landmark_from != UNREACHED)
+        {
+            bound = std::max(bound, landmark_to - landmark_from - (landmark_to + landmark_from) * ROUNDING);
+        }
+
+        if (to_to_landmark != UNREACHED)
+        {
+            bound = std::max(bound, from_to_landmark - to_to_landmark - (from_to_landmark + to_to_landmark) * ROUNDING);
+        }
+    }
+
+    return bound;
+}
+
+template <typename Weight> const std::vector<VertexId> &LandmarkIndex<Weight>::GetLandmarks() const
+{
+    return landmarks_;
+}
+
+/*
+    A* от from до to. heuristic(vertex) — нижняя оценка веса пути vertex -> to (бесконечность отсекает вершину).
+    При допустимой оценке найденный путь кратчайший: вершина может быть извлечена повторно,
+    если к ней нашёлся более короткий путь. Оценка вычисляется не больше одного раза на вершину за запрос.
+*/
+template <typename Weight, typename Heuristic>
+std::optional<typename Router<Weight>::RouteInfo> FindRouteAStar(const DirectedWeightedGraph<Weight> &graph,
+                                                                 VertexId from, VertexId to, Heuristic heuristic)
+{
+    struct Scratch
+    {
+        std::vector<Weight> distances;
+        std::vector<Weight> potentials;
+        std::vector<EdgeId> prev_edges;
+        std::vector<uint32_t> stamps;
+        std::vector<std::pair<Weight, VertexId>> queue;
+        uint32_t stamp = 0;
+    };
+
+    thread_local Scratch scratch;
+
+    if (from >= graph.GetVertexCount() || to >= graph.GetVertexCount())
+    {
+        throw std::out_of_range("vertex is out of range");
+    }
+
+    if (scratch.distances.size() < graph.GetVertexCount())
+    {
+        scratch.distances.resize(graph.GetVertexCount());
+        scratch.potentials.resize(graph.GetVertexCount());
+        scratch.prev_edges.resize(graph.GetVertexCount());
+        scratch.stamps.resize(graph.GetVertexCount(), 0);
+    }
+
+    if (++scratch.stamp == 0)
+    {
+        std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+        scratch.stamp = 1;
+    }
+
+    const uint32_t stamp = scratch.stamp;
+    auto &distances = scratch.distances;
+    auto &potentials = scratch.potentials;
+    auto &queue = scratch.queue;
+    const std::greater<std::pair<Weight, VertexId>> later;
+
+    queue.clear();
+    distances[from] = Weight{};
+    potentials[from] = heuristic(from);
+    scratch.stamps[from] = stamp;
+    queue.emplace_back(potentials[from], from);
+
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), later);
+        const auto [key, vertex] = queue.back();
+        queue.pop_back();
+
+        // Устаревшая запись: к вершине уже нашёлся более короткий путь
+        if (key > distances[vertex] + potentials[vertex])
+        {
+            continue;
+        }
+
+        if (vertex == to)
+        {
+            std::vector<EdgeId> edges;
+
+            for (VertexId current = to; current != from; current = graph.GetEdge(edges.back()).from)
+            {
+                edges.push_back(scratch.prev_edges[current]);
+            }
+
+            std::reverse(edges.begin(), edges.end());
+
+            return typename Router<Weight>::RouteInfo{distances[to], std::move(edges)};
+        }
+
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
+        {
+            const auto &edge = graph.GetEdge(edge_id);
+            const Weight candidate = distances[vertex] + edge.weight;
+
+            if (scratch.stamps[edge.to] != stamp)
+            {
+                scratch.stamps[edge.to] = stamp;
+                potentials[edge.to] = heuristic(edge.to);
+            }
+
+            else if (!(candidate < distances[edge.to]))
+            {
+                continue;
+            }
+
+            if (potentials[edge.to] == std::numeric_limits<Weight>::infinity())
+            {
+                continue;
+            }
+
+            distances[edge.to] = candidate;
+            scratch.prev_edges[edge.to] = edge_id;
+            queue.emplace_back(candidate + potentials[edge.to], edge.to);
+            std::push_heap(queue.begin(), queue.end(), later);
+        }
+    }
+
+    return std::nullopt;
+}
+} // namespace graph
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+namespace graph
+{
+// Лучший путь между наборами вершин: номера начала и конца в исходных наборах, вес вместе с добавками начала
+// и конца и рёбра графа
+template <typename Weight> struct MultiRouteInfo
+{
+    size_t source;
+    size_t target;
+    Weight weight;
+    std::vector<EdgeId> edges;
+};
+
+/*
+    Кратчайший путь от любой из вершин sources до любой из вершин targets за один поиск Дейкстры.
+    У каждой вершины набора своя добавка к весу: поиск начинается из всех вершин sources сразу
+    с весом их добавки, а достижение вершины из targets стоит ещё её добавку. Поиск заканчивается,
+    как только вес в очереди не меньше лучшего найденного пути, поэтому k начал и k концов
+    обходятся дешевле, чем k^2 отдельных запросов.
+*/
+template <typename Weight>
+std::optional<MultiRouteInfo<Weight>> FindRouteBetween(const DirectedWeightedGraph<Weight> &graph,
+                                                       const std::vector<std::pair<VertexId, Weight>> &sources,
+                                                       const std::vector<std::pair<VertexId, Weight>> &targets)
+{
+    struct Scratch
+    {
+        std::vector<Weight> distances;
+        std::vector<EdgeId> prev_edges;
+        std::vector<size_t> origins;
+        std::vector<size_t> target_indices;
+        std::vector<uint32_t> stamps;
+        std::vector<uint32_t> target_stamps;
+        std::vector<std::pair<Weight, VertexId>> queue;
+        uint32_t stamp = 0;
+    };
+
+    thread_local Scratch scratch;
+    const size_t vertex_count = graph.GetVertexCount();
+
+    for (const auto &[vertex, weight] : sources)
+    {
+        if (vertex >= vertex_count)
+        {
+            throw std::out_of_range("vertex is out of range");
+        }
+    }
+
+    for (const auto &[vertex, weight] : targets)
+    {
+        if (vertex >= vertex_count)
+        {
+            throw std::out_of_range("vertex is out of range");
+        }
+    }
+
+    if (scratch.distances.size() < vertex_count)
+    {
+        scratch.distances.resize(vertex_count);
+        scratch.prev_edges.resize(vertex_count);
+        scratch.origins.resize(vertex_count);
+        scratch.target_indices.resize(vertex_count);
+        scratch.stamps.resize(vertex_count, 0);
+        scratch.target_stamps.resize(vertex_count, 0);
+    }
+
+    if (++scratch.stamp == 0)
+    {
+        std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+        std::fill(scratch.target_stamps.begin(), scratch.target_stamps.end(), 0);
+        scratch.stamp = 1;
+    }
+
+    const uint32_t stamp = scratch.stamp;
+    auto &distances = scratch.distances;
+    auto &queue = scratch.queue;
+    const std::greater<std::pair<Weight, VertexId>> later;
+    auto reached = [&](VertexId vertex) { return scratch.stamps[vertex] == stamp; };
+
+    // Если вершина встречается в наборе несколько раз, остаётся вариант с меньшей добавкой
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+        const auto [vertex, weight] = targets[i];
+
+        if (scratch.target_stamps[vertex] != stamp || weight < targets[scratch.target_indices[vertex]].second)
+        {
+            scratch.target_stamps[vertex] = stamp;
+            scratch.target_indices[vertex] = i;
+        }
+    }
+
+    queue.clear();
+
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        const auto [vertex, weight] = sources[i];
+
+        if (!reached(vertex) || weight < distances[vertex])
+        {
+            distances[vertex] = weight;
+            scratch.origins[vertex] = i;
+            scratch.stamps[vertex] = stamp;
+            queue.emplace_back(weight, vertex);
+        }
+    }
+
+    std::make_heap(queue.begin(), queue.end(), later);
+    std::optional<VertexId> best_vertex;
+    Weight best{};
+
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), later);
+        const auto [distance, vertex] = queue.back();
+        queue.pop_back();
+
+        if (best_vertex && !(distance < best))
+        {
+            break;
+        }
+
+        // Устаревшая запись: к вершине уже нашёлся более короткий путь
+        if (distance > distances[vertex])
+        {
+            continue;
+        }
+
+        if (scratch.target_stamps[vertex] == stamp)
+        {
+            const Weight total = distance + targets[scratch.target_indices[vertex]].second;
+
+            if (!best_vertex || total < best)
+            {
+                best_vertex = vertex;
+                best = total;
+            }
+        }
+
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
+        {
+            const auto &edge = graph.GetEdge(edge_id);
+            const Weight candidate = distance + edge.weight;
+
+            if (reached(edge.to) && !(candidate < distances[edge.to]))
+            {
+                continue;
+            }
+
+            distances[edge.to] = candidate;
+            scratch.prev_edges[edge.to] = edge_id;
+            scratch.origins[edge.to] = scratch.origins[vertex];
+            scratch.stamps[edge.to] = stamp;
+            queue.emplace_back(candidate, edge.to);
+            std::push_heap(queue.begin(), queue.end(), later);
+        }
+    }
+
+    if (!best_vertex)
+    {
+        return std::nullopt;
+    }
+
+    const size_t source = scratch.origins[*best_vertex];
+    std::vector<EdgeId> edges;
+
+    for (VertexId current = *best_vertex; current != sources[source].first; current = graph.GetEdge(edges.back()).from)
+    {
+        edges.push_back(scratch.prev_edges[current]);
+    }
+
+    std::reverse(edges.begin(), edges.end());
+
+    return MultiRouteInfo<Weight>{source, scratch.target_indices[*best_vertex], best, std::move(edges)};
+}
+} // namespace graph
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.h"
+#include "transport_catalogue.h"
+
+/*
+    MutationLog — журнал упреждающей записи (WAL) изменений справочника.
+    Каждая запись — это одно изменение (PUT /stop, PUT /bus, PATCH /patch)
+    в компактном двоичном виде: [размер][crc32][данные].
+    Записи накапливаются в памяти и сбрасываются на диск группами одним
+    write() и одним fsync(): поток-писатель ждёт commit_interval или
+    max_batch записей, после чего будит всех ожидающих.
+    Изменение применяется к справочнику только после того, как его запись
+    оказалась на диске. Группа, которую не удалось записать, срезается с конца
+    файла, а её ожидающие получают ошибку. До следующего снимка журнал новые
+    записи не принимает: файл должен оставаться записями поколения подряд.
+    Снимок запоминает позицию журнала (поколение и число записей в нём),
+    после чего Rotate начинает новое поколение с записей, не вошедших в снимок.
+*/
+
+namespace wal
+{
+struct LogSettings
+{
+    std::chrono::milliseconds commit_interval{2}; // Сколько ждать добора группы перед fsync
+    size_t max_batch = 128;                       // Размер группы, при котором сброс начинается сразу
+    bool fsync = true;                            // false — только write(), без гарантий при сбое питания
+};
+
+// Позиция в журнале: всё, что добавлено до неё, учтено в снимке
+struct LogPosition
+{
+    uint64_t generation = 0;
+    uint64_t seq = 0;     // Номер последней записи, как его вернул Append
+    uint64_t records = 0; // Записей поколения generation до позиции
+};
+
+class MutationLog
+{
+  public:
+    // Открывает (или создаёт) журнал. Испорченный хвост, оставшийся от сбоя, отбрасывается
+    MutationLog(std::string path, LogSettings settings);
+    MutationLog(const MutationLog &) = delete;
+    MutationLog &operator=(const MutationLog &) = delete;
+    ~MutationLog();
+
+    // Записи, прочитанные из журнала при открытии, в порядке добавления
+    std::vector<std::string> TakeRecoveredRecords();
+
+    // Ставит запись в очередь и возвращает её номер для WaitDurable
+    uint64_t Append(std::string record);
+    // Блокирует, пока запись с номером seq не окажется на диске; бросает исключение, если её группа не записалась
+    void WaitDurable(uint64_t seq);
+    // Бросает исключение, если после сбоя записи журнал ждёт снимка: вызывается до изменения справочника
+    void CheckWritable() const;
+    bool IsFailed() const;
+    // Очищает журнал и начинает новое поколение: все изменения к этому моменту сохранены в снимке
+    void Reset(uint64_t generation);
+    // Номер последней добавленной записи
+    uint64_t GetLastSeq() const;
+    // Позиция сразу после записи seq; записи до неё должны быть на диске или отклонены
+    LogPosition GetPosition(uint64_t seq) const;
+    // Начинает следующее поколение с записей после position: снимок на position уже сохранён на диске
+    void Rotate(const LogPosition &position);
+    uint64_t GetGeneration() const;
+    uint64_t GetSize() const;
+
+  private:
+    void FlushLoop();
+
+    std::string path_;
+    LogSettings settings_;
+    int fd_ = -1;
+    std::vector<std::string> recovered_;
+    uint64_t generation_ = 0;
+    uint64_t generation_seq_ = 0; // Номер записи, после которой началось текущее поколение
+
+    mutable std::mutex mutex_;
+    std::mutex io_mutex_;
+    std::condition_variable pending_cv_;
+    std::condition_variable durable_cv_;
+    std::string pending_;
+    size_t pending_count_ = 0;
+    uint64_t appended_seq_ = 0;
+    uint64_t durable_seq_ = 0;
+    uint64_t size_ = 0;
+    uint64_t failed_seq_ = 0; // Записи с номерами до failed_seq_, не попавшие на диск, потеряны
+    std::string error_;
+    bool stop_ = false;
+    std::thread flusher_;
+};
+
+// Кодирует base_requests запроса PUT /stop или PUT /bus
+std::string EncodePut(const json::Array &base_requests);
+// Кодирует base_requests запроса PATCH /patch
+std::string EncodePatch(const json::Array &base_requests);
+// Бросает std::invalid_argument, если ApplyRecord отклонит запись: проверка до её записи в журнал
+void CheckRecord(std::string_view record, const tc::TransportCatalogue &catalogue);
+// Применяет запись журнала к справочнику так же, как это делают обработчики запросов
+void ApplyRecord(std::string_view record, tc::TransportCatalogue &catalogue);
+} // namespace wal
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/*
+    Name — название остановки или номер автобуса из общего для процесса неизменяемого хранилища строк.
+    Каждая строка хранится в хранилище один раз (перед символами — длина), Name — указатель на символы,
+    поэтому копирование и сравнение на равенство стоят как у целого числа. Хранилище только растёт:
+    строки живут до конца процесса, и string_view на них можно хранить где угодно.
+    Порядок названий — лексикографический, как у строк.
+*/
+
+namespace names
+{
+class Name
+{
+  public:
+    Name() = default;
+    Name(std::string_view text);
+    Name(const std::string &text) : Name(std::string_view(text))
+    {
+    }
+    Name(const char *text) : Name(std::string_view(text))
+    {
+    }
+
+    std::string_view View() const
+    {
+        if (!data_)
+        {
+            return {};
+        }
+
+        uint32_t size = 0;
+        std::memcpy(&size, data_ - sizeof(size), sizeof(size));
+
+        return {data_, size};
+    }
+
+    operator std::string_view() const
+    {
+        return View();
+    }
+
+    const void *GetHandle() const
+    {
+        return data_;
+    }
+
+    bool empty() const
+    {
+        return !data_;
+    }
+
+    bool operator==(const Name &other) const
+    {
+        return data_ == other.data_;
+    }
+
+    bool operator!=(const Name &other) const
+    {
+        return data_ != other.data_;
+    }
+
+    bool operator<(const Name &other) const
+    {
+        return data_ != other.data_ && View() < other.View();
+    }
+
+  private:
+    const char *data_ = nullptr; // nullptr — пустая строка
+};
+} // namespace names
+
+template <> struct std::hash<names::Name>
+{
+    size_t operator()(const names::Name &name) const noexcept
+    {
+        return std::hash<const void *>{}(name.GetHandle());
+    }
+};
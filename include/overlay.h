@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "parallel.h"
+#include "router.h"
+
+namespace graph
+{
+/*
+    Partition — разбиение вершин графа на ячейки для настраиваемого поиска маршрутов (CRP).
+    Зависит только от топологии: вход ячейки — вершина, в которую ведёт ребро из другой ячейки,
+    выход — вершина, из которой ребро ведёт в другую ячейку. Веса рёбер не используются,
+    поэтому разбиение переживает смену метрики.
+*/
+class Partition
+{
+  public:
+    static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+    template <typename Weight> Partition(const DirectedWeightedGraph<Weight> &graph, std::vector<uint32_t> vertex_cells);
+
+    size_t GetCellCount() const;
+    uint32_t GetCell(VertexId vertex) const;
+    const std::vector<VertexId> &GetCellVertices(uint32_t cell) const;
+    const std::vector<VertexId> &GetEntries(uint32_t cell) const;
+    const std::vector<VertexId> &GetExits(uint32_t cell) const;
+    // Номер вершины в списке вершин её ячейки
+    uint32_t GetLocalIndex(VertexId vertex) const;
+    // Номер вершины среди входов (выходов) её ячейки; NO_INDEX, если вершина не вход (не выход)
+    uint32_t GetEntryIndex(VertexId vertex) const;
+    uint32_t GetExitIndex(VertexId vertex) const;
+
+  private:
+    std::vector<uint32_t> vertex_cells_;
+    std::vector<uint32_t> local_indices_;
+    std::vector<uint32_t> entry_indices_;
+    std::vector<uint32_t> exit_indices_;
+    std::vector<std::vector<VertexId>> cell_vertices_;
+    std::vector<std::vector<VertexId>> entries_;
+    std::vector<std::vector<VertexId>> exits_;
+};
+
+template <typename Weight>
+Partition::Partition(const DirectedWeightedGraph<Weight> &graph, std::vector<uint32_t> vertex_cells)
+    : vertex_cells_(std::move(vertex_cells)), local_indices_(graph.GetVertexCount()),
+      entry_indices_(graph.GetVertexCount(), NO_INDEX), exit_indices_(graph.GetVertexCount(), NO_INDEX)
+{
+    if (vertex_cells_.size() != graph.GetVertexCount())
+    {
+        throw std::invalid_argument("partition must assign a cell to every vertex");
+    }
+
+    const size_t cell_count =
+        vertex_cells_.empty() ? 0 : *std::max_element(vertex_cells_.begin(), vertex_cells_.end()) + size_t{1};
+    cell_vertices_.resize(cell_count);
+    entries_.resize(cell_count);
+    exits_.resize(cell_count);
+
+    for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex)
+    {
+        local_indices_[vertex] = static_cast<uint32_t>(cell_vertices_[vertex_cells_[vertex]].size());
+        cell_vertices_[vertex_cells_[vertex]].push_back(vertex);
+    }
+
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id)
+    {
+        const auto &edge = graph.GetEdge(edge_id);
+        const uint32_t from_cell = vertex_cells_[edge.from];
+        const uint32_t to_cell = vertex_cells_[edge.to];
+
+        if (from_cell == to_cell)
+        {
+            continue;
+        }
+
+        if (exit_indices_[edge.from] == NO_INDEX)
+        {
+            exit_indices_[edge.from] = static_cast<uint32_t>(exits_[from_cell].size());
+            exits_[from_cell].push_back(edge.from);
+        }
+
+        if (entry_indices_[edge.to] == NO_INDEX)
+        {
+            entry_indices_[edge.to] = static_cast<uint32_t>(entries_[to_cell].size());
+            entries_[to_cell].push_back(edge.to);
+        }
+    }
+}
+
+inline size_t Partition::GetCellCount() const
+{
+    return cell_vertices_.size();
+}
+
+inline uint32_t Partition::GetCell(VertexId vertex) const
+{
+    return vertex_cells_.at(vertex);
+}
+
+inline const std::vector<VertexId> &Partition::GetCellVertices(uint32_t cell) const
+{
+    return cell_vertices_.at(cell);
+}
+
+inline const std::vector<VertexId> &Partition::GetEntries(uint32_t cell) const
+{
+    return entries_.at(cell);
+}
+
+inline const std::vector<VertexId> &Partition::GetExits(uint32_t cell) const
+{
+    return exits_.at(cell);
+}
+
+inline uint32_t Partition::GetLocalIndex(VertexId vertex) const
+{
+    return local_indices_[vertex];
+}
+
+inline uint32_t Partition::GetEntryIndex(VertexId vertex) const
+{
+    return entry_indices_[vertex];
+}
+
+inline uint32_t Partition::GetExitIndex(VertexId vertex) const
+{
+    return exit_indices_[vertex];
+}
+
+/*
+    Overlay — метрика поверх разбиения: для каждой ячейки веса кратчайших путей внутри неё
+    от каждого входа до каждого выхода (клика ячейки). Настройка — независимые поиски по ячейкам,
+    которые выполняются параллельно; при смене весов разбиение переиспользуется, пересчитываются только клики.
+    Запрос — Дейкстра, которая в ячейках начала и конца идёт по рёбрам графа, а остальные ячейки
+    проходит по рёбрам клик. Ребро клики в ответе разворачивается поиском внутри ячейки.
+*/
+template <typename Weight> class Overlay
+{
+  public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    Overlay(const DirectedWeightedGraph<Weight> &graph, std::shared_ptr<const Partition> partition,
+            size_t thread_count);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    const std::shared_ptr<const Partition> &GetPartition() const;
+
+  private:
+    static constexpr Weight UNREACHED = std::numeric_limits<Weight>::max();
+
+    // Дейкстра внутри ячейки вершины from; массивы индексируются номерами вершин в ячейке
+    void SearchCell(VertexId from, std::vector<Weight> &distances, std::vector<EdgeId> &prev_edges) const;
+    // Рёбра кратчайшего пути entry -> exit внутри ячейки, в порядке следования
+    std::vector<EdgeId> UnpackCliqueEdge(VertexId entry, VertexId exit) const;
+
+    const DirectedWeightedGraph<Weight> &graph_;
+    std::shared_ptr<const Partition> partition_;
+    // cliques_[cell][entry * число выходов + exit] — вес пути между входом и выходом ячейки
+    std::vector<std::vector<Weight>> cliques_;
+};
+
+template <typename Weight>
+Overlay<Weight>::Overlay(const DirectedWeightedGraph<Weight> &graph, std::shared_ptr<const Partition> partition,
+                         size_t thread_count)
+    : graph_(graph), partition_(std::move(partition)), cliques_(partition_->GetCellCount())
+{
+    parallel::ParallelFor(
+        partition_->GetCellCount(), thread_count,
+        [this](size_t cell) {
+            const auto &entries = partition_->GetEntries(static_cast<uint32_t>(cell));
+            const auto &exits = partition_->GetExits(static_cast<uint32_t>(cell));
+            std::vector<Weight> distances;
+            std::vector<EdgeId> prev_edges;
+            cliques_[cell].resize(entries.size() * exits.size());
+
+            for (size_t entry = 0; entry < entries.size(); ++entry)
+            {
+                SearchCell(entries[entry], distances, prev_edges);
+
+                for (size_t exit = 0; exit < exits.size(); ++exit)
+                {
+                    cliques_[cell][entry * exits.size() + exit] = distances[partition_->GetLocalIndex(exits[exit])];
+                }
+            }
+        },
+        1);
+}
+
+template <typename Weight>
+void Overlay<Weight>::SearchCell(VertexId from, std::vector<Weight> &distances, std::vector<EdgeId> &prev_edges) const
+{
+    const uint32_t cell = partition_->GetCell(from);
+    const size_t size = partition_->GetCellVertices(cell).size();
+    std::vector<std::pair<Weight, VertexId>> queue{{Weight{}, from}};
+    const std::greater<std::pair<Weight, VertexId>> later;
+
+    distances.assign(size, UNREACHED);
+    prev_edges.assign(size, 0);
+    distances[partition_->GetLocalIndex(from)] = Weight{};
+
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), later);
+        const auto [distance, vertex] = queue.back();
+        queue.pop_back();
+
+        if (distance > distances[partition_->GetLocalIndex(vertex)])
+        {
+            continue;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex))
+        {
+            const auto &edge = graph_.GetEdge(edge_id);
+
+            if (partition_->GetCell(edge.to) != cell)
+            {
+                continue;
+            }
+
+            const uint32_t local = partition_->GetLocalIndex(edge.to);
+            const Weight candidate = distance + edge.weight;
+
+            if (candidate < distances[local])
+            {
+                distances[local] = candidate;
+                prev_edges[local] = edge_id;
+                queue.emplace_back(candidate, edge.to);
+                std::push_heap(queue.begin(), queue.end(), later);
+            }
+        }
+    }
+}
+
+template <typename Weight> std::vector<EdgeId> Overlay<Weight>::UnpackCliqueEdge(VertexId entry, VertexId exit) const
+{
+    std::vector<Weight> distances;
+    std::vector<EdgeId> prev_edges;
+    std::vector<EdgeId> edges;
+    SearchCell(entry, distances, prev_edges);
+
+    for (VertexId current = exit; current != entry; current = graph_.GetEdge(edges.back()).from)
+    {
+        edges.push_back(prev_edges[partition_->GetLocalIndex(current)]);
+    }
+
+    std::reverse(edges.begin(), edges.end());
+
+    return edges;
+}
+
+template <typename Weight>
+std::optional<typename Overlay<Weight>::RouteInfo> Overlay<Weight>::BuildRoute(VertexId from, VertexId to) const
+{
+    // Как достигнута вершина: ребром графа или ребром клики из входа ячейки
+    struct Parent
+    {
+        EdgeId edge;
+        VertexId entry;
+        bool via_clique;
+    };
+
+    struct Scratch
+    {
+        std::vector<Weight> distances;
+        std::vector<Parent> parents;
+        std::vector<uint32_t> stamps;
+        std::vector<std::pair<Weight, VertexId>> queue;
+        uint32_t stamp = 0;
+    };
+
+    thread_local Scratch scratch;
+
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount())
+    {
+        throw std::out_of_range("vertex is out of range");
+    }
+
+    if (scratch.distances.size() < graph_.GetVertexCount())
+    {
+        scratch.distances.resize(graph_.GetVertexCount());
+        scratch.parents.resize(graph_.GetVertexCount());
+        scratch.stamps.resize(graph_.GetVertexCount(), 0);
+    }
+
+    if (++scratch.stamp == 0)
+    {
+        std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+        scratch.stamp = 1;
+    }
+
+    const uint32_t stamp = scratch.stamp;
+    const uint32_t source_cell = partition_->GetCell(from);
+    const uint32_t target_cell = partition_->GetCell(to);
+    auto &distances = scratch.distances;
+    auto &queue = scratch.queue;
+    const std::greater<std::pair<Weight, VertexId>> later;
+
+    auto relax = [&](VertexId vertex, Weight candidate, Parent parent) {
+        if (scratch.stamps[vertex] == stamp && !(candidate < distances[vertex]))
+        {
+            return;
+        }
+
+        scratch.stamps[vertex] = stamp;
+        distances[vertex] = candidate;
+        scratch.parents[vertex] = parent;
+        queue.emplace_back(candidate, vertex);
+        std::push_heap(queue.begin(), queue.end(), later);
+    };
+
+    queue.clear();
+    distances[from] = Weight{};
+    scratch.stamps[from] = stamp;
+    queue.emplace_back(Weight{}, from);
+
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), later);
+        const auto [distance, vertex] = queue.back();
+        queue.pop_back();
+
+        if (distance > distances[vertex])
+        {
+            continue;
+        }
+
+        if (vertex == to)
+        {
+            std::vector<EdgeId> edges;
+
+            for (VertexId current = to; current != from;)
+            {
+                const Parent &parent = scratch.parents[current];
+
+                if (parent.via_clique)
+                {
+                    const auto inner = UnpackCliqueEdge(parent.entry, current);
+                    edges.insert(edges.end(), inner.rbegin(), inner.rend());
+                    current = parent.entry;
+                }
+
+                else
+                {
+                    edges.push_back(parent.edge);
+                    current = graph_.GetEdge(parent.edge).from;
+                }
+            }
+
+            std::reverse(edges.begin(), edges.end());
+
+            return RouteInfo{distance, std::move(edges)};
+        }
+
+        const uint32_t cell = partition_->GetCell(vertex);
+        const bool inner_cell = cell != source_cell && cell != target_cell;
+
+        // Ячейку, где нет ни начала, ни конца, пересекаем по клике: от входа сразу к выходам
+        if (inner_cell)
+        {
+            const uint32_t entry = partition_->GetEntryIndex(vertex);
+            const auto &exits = partition_->GetExits(cell);
+
+            for (size_t exit = 0; entry != Partition::NO_INDEX && exit < exits.size(); ++exit)
+            {
+                const Weight weight = cliques_[cell][entry * exits.size() + exit];
+
+                if (weight != UNREACHED)
+                {
+                    relax(exits[exit], distance + weight, Parent{0, vertex, true});
+                }
+            }
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex))
+        {
+            const auto &edge = graph_.GetEdge(edge_id);
+
+            if (inner_cell && partition_->GetCell(edge.to) == cell)
+            {
+                continue;
+            }
+
+            relax(edge.to, distance + edge.weight, Parent{edge_id, 0, false});
+        }
+    }
+
+    return std::nullopt;
+}
+
+template <typename Weight> const std::shared_ptr<const Partition> &Overlay<Weight>::GetPartition() const
+{
+    return partition_;
+}
+} // namespace graph
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+inline size_t DefaultThreadCount()
+{
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+namespace detail
+{
+inline thread_local bool in_worker = false;
+} // namespace detail
+
+// Выполняется ли текущий поток внутри RunWorkers (в том числе вызвавший его поток)
+inline bool IsWorkerThread()
+{
+    return detail::in_worker;
+}
+
+// Барьер для фиксированного числа потоков. Последний пришедший поток выполняет on_completion
+// до того, как остальные продолжат работу
+class Barrier
+{
+  public:
+    explicit Barrier(size_t count) : count_(count)
+    {
+    }
+
+    template <typename Completion> void Wait(Completion on_completion)
+    {
+        std::unique_lock lock(mutex_);
+        const size_t generation = generation_;
+
+        if (++arrived_ == count_)
+        {
+            on_completion();
+            arrived_ = 0;
+            ++generation_;
+            cv_.notify_all();
+            return;
+        }
+
+        cv_.wait(lock, [this, generation] { return generation != generation_; });
+    }
+
+    void Wait()
+    {
+        Wait([] {});
+    }
+
+  private:
+    size_t count_;
+    size_t arrived_ = 0;
+    size_t generation_ = 0;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// Запускает fn(worker_index) в thread_count потоках (включая текущий) и дожидается их завершения.
+// Первое выброшенное исключение пробрасывается вызывающему
+template <typename Function> void RunWorkers(size_t thread_count, Function fn)
+{
+    thread_count = std::max<size_t>(1, thread_count);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto run = [&fn, &error, &error_mutex](size_t worker) {
+        const bool was_worker = detail::in_worker;
+        detail::in_worker = true;
+
+        try
+        {
+            fn(worker);
+        }
+        catch (...)
+        {
+            std::lock_guard lock(error_mutex);
+
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+
+        detail::in_worker = was_worker;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+
+    for (size_t worker = 1; worker < thread_count; ++worker)
+    {
+        threads.emplace_back(run, worker);
+    }
+
+    run(0);
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+// Вызывает fn(index) для index из [0, count). Потоки динамически разбирают порции по chunk индексов,
+// поэтому неравномерная по стоимости работа распределяется сама. Внутри другого RunWorkers цикл выполняется
+// в текущем потоке: внешний уровень уже занял потоки, и вложенный запуск дал бы thread_count^2 потоков
+template <typename Function> void ParallelFor(size_t count, size_t thread_count, Function fn, size_t chunk = 16)
+{
+    std::atomic<size_t> next{0};
+    thread_count = IsWorkerThread() ? 1 : std::min(thread_count, (count + chunk - 1) / chunk);
+
+    RunWorkers(thread_count, [&](size_t) {
+        for (size_t begin; (begin = next.fetch_add(chunk)) < count;)
+        {
+            for (size_t index = begin; index < std::min(begin + chunk, count); ++index)
+            {
+                fn(index);
+            }
+        }
+    });
+}
+} // namespace parallel
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "timetable.h"
+
+/*
+    Raptor — поиск по раундам (RAPTOR): раунд k находит лучшие прибытия ровно с k поездками,
+    просматривая линии от отмеченных в прошлом раунде остановок. Результат — множество Парето
+    по (время прибытия, число пересадок): маршрут с большим числом пересадок попадает в ответ,
+    только если он быстрее всех маршрутов с меньшим числом.
+    С временем отправления поиск идёт по расписанию, без него — по модели routing_settings:
+    каждая посадка занимает bus_wait_time, как в графе TransportRouter.
+    Линии одного раунда независимы и при большом их числе просматриваются параллельно.
+*/
+
+namespace timetable
+{
+class Raptor
+{
+  public:
+    Raptor(const Timetable &timetable, const tc::RoutingSettings &routing_settings);
+
+    // Маршруты множества Парето по возрастанию числа пересадок (не больше max_transfers)
+    std::vector<Journey> FindParetoJourneys(const tc::Stop *from, const tc::Stop *to,
+                                            std::optional<double> depart_at, size_t max_transfers) const;
+
+  private:
+    const Timetable &timetable_;
+    double bus_wait_time_;
+    size_t thread_count_;
+};
+} // namespace timetable
@@ -5,6 +5,9 @@
 
 #include "json.h"
 #include "map_renderer.h"
+#include "ranges.h"
+#include "route_cache.h"
+#include "timetable.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
@@ -12,19 +15,45 @@ class RequestHandler
 {
   public:
     RequestHandler(const tc::TransportCatalogue &catalogue, const renderer::MapRenderer &renderer,
-                   const tc::TransportRouter &router)
-        : catalogue_(catalogue), renderer_(renderer), router_(router)
+                   const tc::TransportRouter &router, cache::RouteCache *route_cache = nullptr)
+        : catalogue_(catalogue), renderer_(renderer), router_(router), route_cache_(route_cache)
     {
     }
 
-    const std::set<std::string> GetBusesByStop(std::string_view stop_name) const;
+    // Номера автобусов через остановку по возрастанию, без копирования
+    ranges::Range<std::vector<names::Name>::const_iterator> GetBusesByStop(std::string_view stop_name) const;
     const std::optional<graph::Router<double>::RouteInfo> GetRoute(const tc::Stop *stop_from,
                                                                    const tc::Stop *stop_to) const;
+    std::optional<graph::MultiRouteInfo<double>> GetRouteBetween(
+        const std::vector<std::pair<const tc::Stop *, double>> &stops_from,
+        const std::vector<std::pair<const tc::Stop *, double>> &stops_to) const;
+    // Ближайшие к point остановки (routing_settings.walk_stop_count_) и время пешком между ними и point
+    std::vector<std::pair<const tc::Stop *, double>> GetWalkingStops(geo::Coordinates point) const;
+    double GetWalkTime(double distance) const;
+    const tc::Stop *GetVertexStop(graph::VertexId vertex) const;
+    std::vector<std::optional<double>> GetRouteTimes(const tc::Stop *stop_from,
+                                                     const std::vector<const tc::Stop *> &stops_to) const;
+    std::vector<std::pair<const tc::Stop *, double>> GetReachableStops(const tc::Stop *stop_from,
+                                                                       double max_time) const;
+    std::optional<timetable::Journey> GetJourney(const tc::Stop *stop_from, const tc::Stop *stop_to,
+                                                double depart_at) const;
+    std::vector<graph::Router<double>::RouteInfo> GetAlternativeRoutes(const tc::Stop *stop_from,
+                                                                       const tc::Stop *stop_to, size_t count,
+                                                                       double max_stretch) const;
+    std::vector<timetable::Journey> GetParetoJourneys(const tc::Stop *stop_from, const tc::Stop *stop_to,
+                                                      std::optional<double> depart_at, size_t max_transfers) const;
+    const tc::RoutingSettings &GetRoutingSettings() const;
     const graph::DirectedWeightedGraph<double> &GetGraph() const;
     svg::Document RenderMap() const;
+    // Напечатанный ответ на запрос Route из кэша; nullptr, если его там нет
+    std::shared_ptr<const cache::PrintedAnswer> FindCachedRoute(const tc::Stop *stop_from,
+                                                                const tc::Stop *stop_to) const;
+    void CacheRoute(const tc::Stop *stop_from, const tc::Stop *stop_to,
+                    std::shared_ptr<const cache::PrintedAnswer> answer) const;
 
   private:
     const tc::TransportCatalogue &catalogue_;
     const renderer::MapRenderer &renderer_;
     const tc::TransportRouter &router_;
+    cache::RouteCache *route_cache_;
 };
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "domain.h"
+
+/*
+    RouteCache — кэш готовых ответов на запросы Route.
+    Ключ — пара остановок, значение — ответ, уже напечатанный как элемент массива ответов,
+    без значения request_id. Кэш разбит на шарды со своим мьютексом и LRU-списком,
+    общий объём ограничен числом записей. Каждая запись помечена поколением маршрутизатора:
+    встретив более новое поколение, шард очищается целиком.
+*/
+
+namespace cache
+{
+// Ответ, напечатанный как элемент массива ответов: текст до значения request_id и после него
+struct PrintedAnswer
+{
+    std::string before_id;
+    std::string after_id;
+};
+
+struct RouteCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+};
+
+class RouteCache
+{
+  public:
+    // capacity == 0 отключает кэш
+    explicit RouteCache(size_t capacity = 4096, size_t shard_count = 16);
+    RouteCache(const RouteCache &) = delete;
+    RouteCache &operator=(const RouteCache &) = delete;
+
+    std::shared_ptr<const PrintedAnswer> Find(const tc::Stop *from, const tc::Stop *to, uint64_t generation);
+    void Insert(const tc::Stop *from, const tc::Stop *to, uint64_t generation,
+                std::shared_ptr<const PrintedAnswer> answer);
+    void Clear();
+    RouteCacheStats GetStats() const;
+
+  private:
+    using Key = std::pair<const tc::Stop *, const tc::Stop *>;
+
+    struct KeyHasher
+    {
+        size_t operator()(const Key &key) const
+        {
+            // Указатели выровнены, поэтому младшие биты перемешиваются, иначе все ключи попадут в один шард
+            uint64_t hash = reinterpret_cast<uintptr_t>(key.first) * 37 + reinterpret_cast<uintptr_t>(key.second);
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdULL;
+            hash ^= hash >> 33;
+
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::shared_ptr<const PrintedAnswer> answer;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        uint64_t generation = 0;
+        std::list<Entry> entries; // В начале — самые свежие
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHasher> index;
+    };
+
+    Shard &GetShard(const Key &key);
+    // Приводит шард к поколению generation; false, если запрос относится к устаревшему маршрутизатору
+    static bool SyncGeneration(Shard &shard, uint64_t generation);
+
+    size_t shard_capacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+} // namespace cache
@@ -1,39 +1,102 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <iterator>
+#include <limits>
 #include <map>
+#include <new>
 #include <optional>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "domain.h"
 #include "graph.h"
+#include "parallel.h"
 
 namespace graph
 {
+namespace detail
+{
+inline constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Аллокатор, выравнивающий начало буфера по строке кэша
+template <typename T> struct CacheAlignedAllocator
+{
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+
+    template <typename U> CacheAlignedAllocator(const CacheAlignedAllocator<U> &)
+    {
+    }
+
+    T *allocate(size_t count)
+    {
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t{CACHE_LINE_SIZE}));
+    }
+
+    void deallocate(T *ptr, size_t)
+    {
+        ::operator delete(ptr, std::align_val_t{CACHE_LINE_SIZE});
+    }
+
+    template <typename U> bool operator==(const CacheAlignedAllocator<U> &) const
+    {
+        return true;
+    }
+
+    template <typename U> bool operator!=(const CacheAlignedAllocator<U> &) const
+    {
+        return false;
+    }
+};
+
+inline constexpr size_t SIMD_BYTES = 16;
+
+// Векторный тип для релаксации строки; по умолчанию (не плавающая точка) векторизации нет
+template <typename T> struct SimdVector
+{
+};
+
+template <> struct SimdVector<double>
+{
+    typedef double Type __attribute__((vector_size(SIMD_BYTES)));
+};
+
+template <> struct SimdVector<float>
+{
+    typedef float Type __attribute__((vector_size(SIMD_BYTES)));
+};
+} // namespace detail
+
+/*
+    Router — предрасчёт кратчайших путей между всеми парами вершин (алгоритм Флойда — Уоршелла).
+    Веса хранятся в плотной матрице с выравниванием по строке кэша, отсутствие пути обозначается
+    бесконечным весом. Последнее ребро каждого пути лежит в параллельной матрице uint32_t.
+    Матрица обрабатывается блоками BLOCK_SIZE x BLOCK_SIZE, а внутренний цикл релаксации
+    векторизован, поэтому ветвления на каждую ячейку нет.
+*/
 template <typename Weight> class Router
 {
   private:
     using Graph = DirectedWeightedGraph<Weight>;
 
   public:
-    Router(const Graph &graph)
-        : graph_(graph), routes_internal_data_(graph.GetVertexCount(),
-                                               std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    // thread_count > 1 включает параллельный предрасчёт; результат не зависит от числа потоков
+    Router(const Graph &graph, size_t thread_count = 1)
+        : graph_(graph), vertex_count_(graph.GetVertexCount()),
+          stride_((vertex_count_ + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE), weights_(stride_ * stride_, INFINITE_WEIGHT),
+          prev_edges_(stride_ * stride_, NO_EDGE)
     {
         InitializeRoutesInternalData(graph);
-
-        const size_t vertex_count = graph.GetVertexCount();
-
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through)
-        {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
-        }
+        RelaxRoutesInternalData(thread_count);
     }
 
     struct RouteInfo
@@ -43,25 +106,48 @@ template <typename Weight> class Router
     };
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    // Вес кратчайшего пути from -> to и последнее ребро на нём (используется при сериализации)
+    std::optional<std::pair<Weight, std::optional<EdgeId>>> GetRouteData(VertexId from, VertexId to) const;
     void SetVertexId(std::map<const tc::Stop *, graph::VertexId> stop_to_vertex_id);
     graph::VertexId GetVertexId(const tc::Stop *stop);
     const graph::DirectedWeightedGraph<double> &GetGraph() const;
 
   private:
-    struct RouteInternalData
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
+
+    Weight *GetWeights(VertexId from)
     {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
-    };
+        return weights_.data() + from * stride_;
+    }
+
+    uint32_t *GetPrevEdges(VertexId from)
+    {
+        return prev_edges_.data() + from * stride_;
+    }
 
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    size_t GetIndex(VertexId from, VertexId to) const
+    {
+        if (from >= vertex_count_ || to >= vertex_count_)
+        {
+            throw std::out_of_range("vertex is out of range");
+        }
+
+        return from * stride_ + to;
+    }
 
     void InitializeRoutesInternalData(const Graph &graph)
     {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+        if (graph.GetEdgeCount() >= NO_EDGE)
+        {
+            throw std::length_error("too many edges for routes table");
+        }
+
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex)
         {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            GetWeights(vertex)[vertex] = ZERO_WEIGHT;
 
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
             {
@@ -72,47 +158,158 @@ template <typename Weight> class Router
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
 
-                auto &route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight)
+                if (edge.weight < GetWeights(vertex)[edge.to])
+                {
+                    GetWeights(vertex)[edge.to] = edge.weight;
+                    GetPrevEdges(vertex)[edge.to] = static_cast<uint32_t>(edge_id);
+                }
+            }
+        }
+    }
+
+    // Релаксирует ячейки [begin, end) строки row_from через вершину с весом пути weight_through до неё.
+    // Путь продлевается только при строгом улучшении, и его последним ребром становится последнее ребро
+    // пути из промежуточной вершины
+    static void RelaxRow(Weight *row_from, uint32_t *prev_from, const Weight *row_through,
+                         const uint32_t *prev_through, Weight weight_through, size_t begin, size_t end)
+    {
+        if constexpr (std::is_same_v<Weight, double> || std::is_same_v<Weight, float>)
+        {
+            using Vector = typename detail::SimdVector<Weight>::Type;
+            constexpr size_t LANES = sizeof(Vector) / sizeof(Weight);
+
+            for (size_t to = begin; to < end; to += LANES)
+            {
+                Vector candidate;
+                Vector current;
+                std::memcpy(&candidate, row_through + to, sizeof(Vector));
+                std::memcpy(&current, row_from + to, sizeof(Vector));
+                candidate = candidate + weight_through;
+                const auto better = candidate < current;
+
+                // Улучшения редки, поэтому основной путь — одно векторное сравнение без записи
+                bool improved = false;
+
+                for (size_t lane = 0; lane < LANES; ++lane)
+                {
+                    improved |= better[lane] != 0;
+                }
+
+                if (!improved)
                 {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                    continue;
+                }
+
+                for (size_t lane = 0; lane < LANES; ++lane)
+                {
+                    if (better[lane])
+                    {
+                        row_from[to + lane] = candidate[lane];
+                        prev_from[to + lane] = prev_through[to + lane];
+                    }
+                }
+            }
+        }
+
+        else
+        {
+            for (size_t to = begin; to < end; ++to)
+            {
+                if (const Weight candidate = weight_through + row_through[to]; candidate < row_from[to])
+                {
+                    row_from[to] = candidate;
+                    prev_from[to] = prev_through[to];
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData &route_from,
-                    const RouteInternalData &route_to)
+    // Релаксация блока (block_from, block_to) через вершины блока block_through
+    void RelaxBlock(size_t block_from, size_t block_to, size_t block_through)
     {
-        auto &route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
+        const size_t to_begin = block_to * BLOCK_SIZE;
+        const size_t to_end = to_begin + BLOCK_SIZE;
 
-        if (!route_relaxing || candidate_weight < route_relaxing->weight)
+        for (VertexId through = block_through * BLOCK_SIZE; through < (block_through + 1) * BLOCK_SIZE; ++through)
         {
-            route_relaxing = {candidate_weight, route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+            const Weight *row_through = GetWeights(through);
+            const uint32_t *prev_through = GetPrevEdges(through);
+
+            for (VertexId from = block_from * BLOCK_SIZE; from < (block_from + 1) * BLOCK_SIZE; ++from)
+            {
+                if (const Weight weight_through = GetWeights(from)[through]; weight_through != INFINITE_WEIGHT)
+                {
+                    RelaxRow(GetWeights(from), GetPrevEdges(from), row_through, prev_through, weight_through, to_begin,
+                             to_end);
+                }
+            }
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through)
+    /*
+        Блочный Флойд — Уоршелл. Для каждого блока-посредника k:
+        1. диагональный блок (k, k);
+        2. блоки строки k и столбца k — они зависят только от диагонального;
+        3. остальные блоки — зависят только от блоков строки и столбца k.
+        Внутри фаз 2 и 3 блоки независимы, потоки разбирают их через общий счётчик и встречаются
+        на барьере. Каждый блок обрабатывает ровно один поток, поэтому результат детерминирован
+    */
+    void RelaxRoutesInternalData(size_t thread_count)
     {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from)
+        const size_t block_count = stride_ / BLOCK_SIZE;
+
+        if (block_count == 0)
         {
-            if (const auto &route_from = routes_internal_data_[vertex_from][vertex_through])
+            return;
+        }
+
+        // Больше потоков, чем независимых блоков фазы 3, не нужно
+        thread_count = std::clamp<size_t>(thread_count, 1, std::max<size_t>(1, (block_count - 1) * (block_count - 1)));
+        std::atomic<size_t> next_task{0};
+        parallel::Barrier barrier(thread_count);
+        auto reset_tasks = [&next_task] { next_task = 0; };
+
+        parallel::RunWorkers(thread_count, [&](size_t worker) {
+            for (size_t through = 0; through < block_count; ++through)
             {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to)
+                if (worker == 0)
+                {
+                    RelaxBlock(through, through, through);
+                }
+
+                barrier.Wait();
+
+                for (size_t task; (task = next_task.fetch_add(1)) < 2 * block_count;)
+                {
+                    if (const size_t block = task / 2; block != through)
+                    {
+                        task % 2 ? RelaxBlock(block, through, through) : RelaxBlock(through, block, through);
+                    }
+                }
+
+                barrier.Wait(reset_tasks);
+
+                for (size_t task; (task = next_task.fetch_add(1)) < block_count * block_count;)
                 {
-                    if (const auto &route_to = routes_internal_data_[vertex_through][vertex_to])
+                    const size_t block_from = task / block_count;
+                    const size_t block_to = task % block_count;
+
+                    if (block_from != through && block_to != through)
                     {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+                        RelaxBlock(block_from, block_to, through);
                     }
                 }
+
+                barrier.Wait(reset_tasks);
             }
-        }
+        });
     }
 
-    static constexpr Weight ZERO_WEIGHT{};
     const Graph &graph_;
-    RoutesInternalData routes_internal_data_;
+    size_t vertex_count_;
+    size_t stride_; // Длина строки матрицы: число вершин, дополненное до кратного BLOCK_SIZE
+    std::vector<Weight, detail::CacheAlignedAllocator<Weight>> weights_;
+    std::vector<uint32_t, detail::CacheAlignedAllocator<uint32_t>> prev_edges_;
     std::map<const tc::Stop *, graph::VertexId> stop_to_vertex_id_ = {};
 };
 
@@ -132,27 +329,46 @@ template <typename Weight> const graph::DirectedWeightedGraph<double> &Router<We
     return graph_;
 }
 
+template <typename Weight>
+std::optional<std::pair<Weight, std::optional<EdgeId>>> Router<Weight>::GetRouteData(VertexId from, VertexId to) const
+{
+    const size_t index = GetIndex(from, to);
+
+    if (weights_[index] == INFINITE_WEIGHT)
+    {
+        return std::nullopt;
+    }
+
+    std::optional<EdgeId> prev_edge;
+
+    if (prev_edges_[index] != NO_EDGE)
+    {
+        prev_edge = prev_edges_[index];
+    }
+
+    return std::pair{weights_[index], prev_edge};
+}
+
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from, VertexId to) const
 {
-    const auto &route_internal_data = routes_internal_data_.at(from).at(to);
+    const size_t index = GetIndex(from, to);
 
-    if (!route_internal_data)
+    if (weights_[index] == INFINITE_WEIGHT)
     {
         return std::nullopt;
     }
 
-    const Weight weight = route_internal_data->weight;
     std::vector<EdgeId> edges;
 
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge; edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (uint32_t edge_id = prev_edges_[index]; edge_id != NO_EDGE;
+         edge_id = prev_edges_[from * stride_ + graph_.GetEdge(edge_id).from])
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
     }
 
     std::reverse(edges.begin(), edges.end());
 
-    return RouteInfo{weight, std::move(edges)};
+    return RouteInfo{weights_[index], std::move(edges)};
 }
-} // end namespace graph
\ No newline at end of file
+} // end namespace graph
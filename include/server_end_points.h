@@ -4,4 +4,5 @@ void RegisterLoadEndpoints(httplib::Server &svr, ServerState &state);
 void RegisterQueryEndpoints(httplib::Server &svr, ServerState &state);
 void RegisterMapEndpoints(httplib::Server &svr, ServerState &state);
 void RegisterPutEndpoints(httplib::Server &svr, ServerState &state);
-void RegisterPatchEndpoints(httplib::Server &svr, ServerState &state);
\ No newline at end of file
+void RegisterPatchEndpoints(httplib::Server &svr, ServerState &state);
+void RegisterImageEndpoints(httplib::Server &svr, ServerState &state);
\ No newline at end of file
@@ -5,10 +5,17 @@
 
 #include <string>
 
-void HandleLoad(const std::string &body, ServerState &state);
+std::string HandleLoad(const std::string &body, ServerState &state);
+// Меняет bus_wait_time и bus_velocity маршрутизатора, не трогая справочник
+std::string HandleRoutingSettings(const std::string &body, ServerState &state);
 void HandleQuery(const std::string &body, httplib::Response &res, ServerState &state);
 void HandleMap(httplib::Response &res, ServerState &state);
+void HandleRouteCacheStats(httplib::Response &res, ServerState &state);
 void HandlePutStop(const std::string &body, ServerState &state);
 void HandlePutBus(const std::string &body, ServerState &state);
 void HandlePatch(const std::string &body, ServerState &state);
-void HandlePatchBus(const json::Dict &request, ServerState &state);
\ No newline at end of file
+void HandleSaveImage(const std::string &body, ServerState &state);
+void HandleOpenImage(const std::string &path, ServerState &state);
+void HandleRestore(const std::string &data_dir, const wal::LogSettings &settings, ServerState &state);
+void HandleCompaction(ServerState &state);
+std::string ParseImagePath(const std::string &body);
\ No newline at end of file
@@ -1,12 +1,40 @@
 #pragma once
 
+#include "../include/catalogue_image.h"
 #include "../include/json_reader.h"
+#include "../include/mutation_log.h"
+#include "../include/route_cache.h"
+
+#include <condition_variable>
+#include <shared_mutex>
 
 struct ServerState
 {
     std::unique_ptr<tc::TransportCatalogue> catalogue;
     std::unique_ptr<renderer::MapRenderer> renderer;
-    std::unique_ptr<tc::TransportRouter> router;
+    std::shared_ptr<tc::TransportRouter> router; // Снимок дописывает образ по нему уже без блокировки
     std::unique_ptr<RequestHandler> request_handler;
     std::unique_ptr<json_reader::JsonReader> json_reader;
+    std::shared_ptr<const image::CatalogueImage> image;
+    std::string map_svg; // Карта, отрисованная при загрузке; сбрасывается при изменении справочника
+    bool read_only = false;
+    bool router_stale = false; // PUT/PATCH изменили справочник после построения маршрутизатора
+    uint64_t version = 0;      // Растёт при каждой замене или изменении справочника и маршрутизатора
+    std::unique_ptr<wal::MutationLog> log;
+    uint64_t applied_seq = 0; // Последняя запись журнала, применённая к справочнику
+    // Записи применяются в порядке журнала: изменение ждёт, пока применят предыдущие
+    std::condition_variable_any applied_cv;
+    std::string snapshot_path;
+    // Ответы на запросы Route; записи прежнего маршрутизатора вытесняются по номеру поколения
+    std::unique_ptr<cache::RouteCache> route_cache = std::make_unique<cache::RouteCache>();
+    // Запросы на чтение берут разделяемую блокировку, изменения справочника — исключительную
+    std::shared_mutex mutex;
+    // Устаревший маршрутизатор перестраивает один запрос, остальные ждут его; берётся до mutex
+    std::mutex router_mutex;
+    // Загрузка и смена настроек держат её исключительно, пока их снимок не ляжет на диск,
+    // изменения справочника — разделяемо: до снимка в журнал не попадёт изменение нового справочника.
+    // Берётся до snapshot_mutex и mutex
+    std::shared_mutex mutation_mutex;
+    // Снимки пишутся по одному, а справочник при этом не заменяется; берётся до mutex
+    std::mutex snapshot_mutex;
 };
\ No newline at end of file
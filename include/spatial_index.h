@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+
+/*
+    StopIndex — k-d дерево по остановкам для поиска ближайших и попадающих в радиус.
+    Остановки хранятся как точки единичной сферы (x, y, z): длина хорды растёт вместе с расстоянием
+    по поверхности, поэтому ближайшие по хорде — ближайшие и на карте, без особых случаев у полюсов
+    и 180-го меридиана. Дерево неявное: узел — середина своего отрезка массива.
+    Новые остановки сначала попадают в буфер, который просматривается целиком; когда буфер вырастает
+    до восьмой части дерева, дерево перестраивается, так что добавление стоит O(log n) амортизированно.
+    Удалённые остановки остаются в дереве до перестроения и пропускаются при поиске.
+*/
+
+namespace spatial
+{
+class StopIndex
+{
+  public:
+    using StopDistances = std::vector<std::pair<const tc::Stop *, double>>;
+
+    void Add(const tc::Stop *stop);
+    void Remove(const tc::Stop *stop);
+    size_t GetSize() const;
+    // До count ближайших к point остановок с расстоянием в метрах, по возрастанию расстояния
+    StopDistances FindNearest(geo::Coordinates point, size_t count) const;
+    // Остановки не дальше radius метров от point, по возрастанию расстояния
+    StopDistances FindInRadius(geo::Coordinates point, double radius) const;
+
+  private:
+    struct Node
+    {
+        geo::SpherePoint point;
+        const tc::Stop *stop;
+        uint8_t axis; // Ось разбиения узла: 0 — x, 1 — y, 2 — z
+    };
+
+    // Кандидаты поиска: квадрат хорды и остановка
+    using Candidates = std::vector<std::pair<double, const tc::Stop *>>;
+
+    void Rebuild();
+    bool IsRemoved(const tc::Stop *stop) const;
+    void Build(size_t begin, size_t end);
+    void SearchNearest(size_t begin, size_t end, const geo::SpherePoint &point, size_t count,
+                       Candidates &nearest) const;
+    void SearchRadius(size_t begin, size_t end, const geo::SpherePoint &point, double max_square,
+                      Candidates &found) const;
+
+    std::vector<Node> tree_;
+    std::vector<Node> pending_;
+    std::unordered_set<const tc::Stop *> removed_;
+};
+} // namespace spatial
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "domain.h"
+
+/*
+    StopNameIndex — поиск остановок по началу слов названия, с опечатками.
+    Названия приводятся к нижнему регистру (латиница и кириллица, «ё» совпадает с «е»). Для каждого слова
+    названия хранится запись (название, смещение слова), записи отсортированы по остатку названия от
+    смещения. Записи с общим началом идут подряд, поэтому массив работает как неявное префиксное дерево:
+    поиск без ошибок — двоичный поиск диапазона, поиск с ошибками обходит дерево в глубину и для каждого
+    узла считает строку таблицы расстояния Левенштейна, отсекая узлы, где ошибок уже больше допустимого.
+    Новые названия попадают в небольшой отсортированный буфер, который вливается в основной массив,
+    когда вырастает до MAX_PENDING_SIZE записей.
+*/
+
+namespace search
+{
+class StopNameIndex
+{
+  public:
+    struct Page
+    {
+        std::vector<const tc::Stop *> stops;
+        size_t total = 0; // Сколько остановок найдено всего, без учёта offset и limit
+    };
+
+    // Остановка с уже известным названием заменяет прежнюю
+    void Add(const tc::Stop *stop);
+    // Остановки, у которых одно из слов названия начинается с query с точностью до регистра и max_edits правок
+    // (вставка, удаление или замена символа). Порядок: меньше правок, затем совпадение всего названия,
+    // начала названия, начала другого слова, затем короче и по алфавиту
+    Page Find(std::string_view query, size_t max_edits, size_t offset, size_t limit) const;
+
+    // Текст в нижнем регистре для сравнения
+    static std::string Fold(std::string_view text);
+
+  private:
+    struct Name
+    {
+        std::string folded;
+        const tc::Stop *stop;
+    };
+
+    struct Entry
+    {
+        uint32_t name;   // Номер в names_
+        uint32_t offset; // Начало слова в folded, в байтах
+    };
+
+    std::string_view GetKey(const Entry &entry) const;
+    void Insert(const Entry &entry);
+    // Совпадения в одном отсортированном массиве записей: для названия — лучший код
+    // ((правки << 2 | вид совпадения) << 32 | длина названия), порядок кодов совпадает с порядком выдачи
+    void Collect(const std::vector<Entry> &entries, std::string_view query, const std::u32string &code_points,
+                 size_t max_edits, std::vector<uint64_t> &codes, std::vector<uint32_t> &found) const;
+
+    std::vector<Name> names_;
+    std::unordered_map<std::string_view, uint32_t> name_indices_;
+    std::vector<Entry> entries_;
+    std::vector<Entry> pending_;
+};
+} // namespace search
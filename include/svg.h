@@ -254,8 +254,9 @@ class Text : public Object, public PathProps<Text>
     // Задаёт толщину шрифта (атрибут font-weight)
     Text &SetFontWeight(std::string font_weight);
 
-    // Задаёт текстовое содержимое объекта (отображается внутри тэга text)
-    Text &SetData(std::string data);
+    // Задаёт текстовое содержимое объекта (отображается внутри тэга text).
+    // Текст не копируется: строка должна жить, пока выводится документ
+    Text &SetData(std::string_view data);
 
   private:
     void RenderObject(const RenderContext &context) const override;
@@ -264,7 +265,7 @@ class Text : public Object, public PathProps<Text>
     uint32_t font_size_ = 1;
     std::string font_family_;
     std::string font_weight_;
-    std::string data_;
+    std::string_view data_;
 };
 
 class ObjectContainer
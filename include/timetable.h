@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+/*
+    Timetable — расписание движения, построенное по маршрутам справочника и routing_settings.
+    Каждый автобус даёт одну линию, некольцевой — по линии в каждую сторону. Линия — это
+    последовательность остановок, время в пути от начальной остановки до каждой из них
+    (со скоростью bus_velocity) и отсортированный массив отправлений с начальной остановки.
+    Время везде — минуты от полуночи, расписание охватывает одни сутки.
+*/
+
+namespace timetable
+{
+inline constexpr double MINUTES_PER_DAY = 24 * 60;
+
+struct Line
+{
+    const tc::Bus *bus = nullptr;
+    std::vector<uint32_t> stops;   // Индексы остановок в Timetable
+    std::vector<double> offsets;   // Время от начальной остановки линии до каждой остановки
+    std::vector<double> departures; // Отправления с начальной остановки, по возрастанию
+};
+
+// Поездка на одном автобусе от from до to
+struct Leg
+{
+    const tc::Bus *bus = nullptr;
+    const tc::Stop *from = nullptr;
+    const tc::Stop *to = nullptr;
+    size_t span_count = 0;
+    double departure = 0.0;
+    double arrival = 0.0;
+};
+
+struct Journey
+{
+    double departure = 0.0;
+    double arrival = 0.0;
+    std::vector<Leg> legs;
+};
+
+class Timetable
+{
+  public:
+    Timetable(const tc::TransportCatalogue &catalogue, const tc::RoutingSettings &routing_settings);
+
+    size_t GetStopCount() const;
+    std::optional<uint32_t> FindStopIndex(const tc::Stop *stop) const;
+    const tc::Stop *GetStop(uint32_t index) const;
+    const std::vector<Line> &GetLines() const;
+    // Линии, проходящие через остановку: (номер линии, позиция остановки в линии)
+    const std::vector<std::pair<uint32_t, uint32_t>> &GetStopLines(uint32_t stop) const;
+
+    // Рейс (индекс в line.departures), ближайший к отправлению от position-й остановки не раньше time.
+    // Время рейса на остановке всегда считается как departures[trip] + offsets[position], без вычитаний:
+    // иначе ошибка округления сдвигает время и пересадка ровно ко времени отправления теряется
+    static std::optional<size_t> NextTrip(const Line &line, size_t position, double time);
+    // Ближайшее отправление линии от её position-й остановки не раньше time
+    static std::optional<double> NextDeparture(const Line &line, size_t position, double time);
+
+  private:
+    void AddLine(const tc::TransportCatalogue &catalogue, const tc::Bus *bus, std::vector<const tc::Stop *> stops,
+                 const std::vector<double> &departures, double velocity);
+
+    std::vector<const tc::Stop *> stops_;
+    std::unordered_map<const tc::Stop *, uint32_t> stop_indices_;
+    std::vector<Line> lines_;
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> stop_lines_;
+};
+
+// Маршрут с самым ранним прибытием при отправлении из from не раньше depart_at.
+// Дейкстра по остановкам, где вес ребра зависит от времени: ожидание ближайшего отправления плюс поездка
+std::optional<Journey> FindEarliestArrival(const Timetable &timetable, const tc::Stop *from, const tc::Stop *to,
+                                           double depart_at);
+} // namespace timetable
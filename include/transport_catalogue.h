@@ -12,6 +12,8 @@
 
 #include "domain.h"
 #include "geo.h"
+#include "spatial_index.h"
+#include "stop_search.h"
 
 namespace tc
 {
@@ -37,7 +39,7 @@ struct Hasher
 
 class TransportCatalogue
 {
-    using StopMap = std::unordered_map<std::string_view, const Stop *>;
+    using StopMap = std::unordered_map<std::string_view, Stop *>;
     using BusMap = std::unordered_map<std::string_view, Bus *>;
     using HashedStops = std::unordered_set<const Stop *, Hasher>;
     using HashedDistanceBtwStops = std::unordered_map<std::pair<const Stop *, const Stop *>, int, Hasher>;
@@ -53,8 +55,13 @@ class TransportCatalogue
     const std::map<std::string_view, const Bus *> GetAllBuses() const;
     void SetDistance(const Stop *from, const Stop *to, const int distance);
     int GetDistance(const Stop *from, const Stop *to) const;
+    const HashedDistanceBtwStops &GetAllDistances() const;
     std::pair<int, double> GetRouteLength(const tc::Bus *bus) const;
     std::optional<tc::BusStat> GetBusStat(const std::string_view bus_number) const;
+    // Поиск остановок по координатам; индекс пополняется в AddStop
+    const spatial::StopIndex &GetStopIndex() const;
+    // Поиск остановок по началу слов названия; индекс пополняется в AddStop
+    const search::StopNameIndex &GetStopNameIndex() const;
 
   private:
     std::deque<Stop> stops_;
@@ -62,5 +69,7 @@ class TransportCatalogue
     std::deque<Bus> buses_;
     BusMap busname_to_bus_;
     HashedDistanceBtwStops dist_btw_stops;
+    spatial::StopIndex stop_index_;
+    search::StopNameIndex stop_name_index_;
 };
 } // namespace tc
\ No newline at end of file
@@ -1,37 +1,141 @@
 #pragma once
 
+#include "landmarks.h"
+#include "multi_route.h"
+#include "overlay.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
 #include <memory>
 
+namespace image
+{
+class CatalogueImage;
+} // namespace image
+
+namespace timetable
+{
+class Timetable;
+class ConnectionScan;
+struct Journey;
+} // namespace timetable
+
 namespace tc
 {
+// Алгоритм для запросов с временем отправления
+enum class TimetableEngine
+{
+    DIJKSTRA,
+    CONNECTION_SCAN,
+};
+
+// Способ отвечать на запросы маршрута без времени отправления
+enum class RouteEngine
+{
+    ALL_PAIRS, // Таблица кратчайших путей между всеми вершинами
+    ALT,       // A* с ориентирами: без квадратичной таблицы, поиск на каждый запрос
+    CRP,       // Разбиение на ячейки и клики ячеек: смена метрики пересчитывает только клики
+};
+
 struct RoutingSettings
 {
     int bus_wait_time_ = 0;
     double bus_velocity_ = 0.0;
+    size_t build_threads_ = 1; // Число потоков предрасчёта маршрутов
+    // Расписания по номеру автобуса; автобусы без расписания ходят весь день с интервалом bus_wait_time_
+    std::map<std::string, std::vector<Headway>> bus_schedules_;
+    TimetableEngine timetable_engine_ = TimetableEngine::DIJKSTRA;
+    RouteEngine route_engine_ = RouteEngine::ALL_PAIRS;
+    size_t landmark_count_ = 8;  // Число ориентиров для RouteEngine::ALT
+    size_t cell_size_ = 32;      // Наибольшее число остановок в ячейке для RouteEngine::CRP
+    double walk_speed_ = 5.0;    // Скорость пешком, км/ч
+    size_t walk_stop_count_ = 3; // Сколько ближайших остановок рассматривается у точки начала или конца
+    double walk_radius_ = 0.0;   // Пересадки пешком между остановками не дальше, м; 0 — без пеших пересадок
 };
 
 class TransportRouter
 {
   public:
     TransportRouter(const RoutingSettings &routing_settings, const TransportCatalogue &catalogue)
-        : routing_settings_(routing_settings)
+        : generation_(NextGeneration()), routing_settings_(routing_settings)
     {
         BuildGraph(catalogue);
     }
 
+    // Новые время ожидания и скорость на топологии и разбиении base (RouteEngine::CRP):
+    // граф перевзвешивается, а из предрасчёта заново считаются только клики ячеек
+    TransportRouter(const TransportRouter &base, const RoutingSettings &routing_settings,
+                    const TransportCatalogue &catalogue);
+
+    // Режим только для чтения: граф и настройки берутся из отображённого в память образа.
+    // RouteEngine::ALL_PAIRS отвечает по таблице образа, для остальных способов предрасчёт строится по графу образа
+    TransportRouter(std::shared_ptr<const image::CatalogueImage> image, const TransportCatalogue &catalogue);
+
     const std::optional<graph::Router<double>::RouteInfo> GetRoute(const tc::Stop *stop_from,
                                                                    const tc::Stop *stop_to) const;
+    // Лучший маршрут от любой из stops_from до любой из stops_to за один поиск;
+    // у каждой остановки своё время пешком до неё (для stops_from) или от неё (для stops_to)
+    std::optional<graph::MultiRouteInfo<double>> GetRouteBetween(
+        const std::vector<std::pair<const tc::Stop *, double>> &stops_from,
+        const std::vector<std::pair<const tc::Stop *, double>> &stops_to) const;
+    // Время пешком на distance метров
+    double GetWalkTime(double distance) const;
+    // Ребро пешей пересадки: идёт из вершины ожидания одной остановки в вершину ожидания другой
+    static bool IsWalkEdge(const graph::Edge<double> &edge);
+    // Остановка вершины графа
+    const tc::Stop *GetVertexStop(graph::VertexId vertex) const;
+    // Время в пути от stop_from до каждой из stops_to за один проход по строке таблицы маршрутов
+    std::vector<std::optional<double>> GetRouteTimes(const tc::Stop *stop_from,
+                                                     const std::vector<const tc::Stop *> &stops_to) const;
+    // Остановки, до которых можно добраться из stop_from не дольше чем за max_time, с временем прибытия
+    std::vector<std::pair<const tc::Stop *, double>> GetReachableStops(const tc::Stop *stop_from,
+                                                                       double max_time) const;
     const graph::DirectedWeightedGraph<double> &GetRouteGraph() const;
+    const graph::Router<double> *GetRouter() const;
+    // Образ, по таблице которого отвечает маршрутизатор; nullptr, если таблицы образа он не использует
+    const image::CatalogueImage *GetImage() const;
+    // Длина ребра графа в метрах; у рёбер ожидания 0
+    const std::vector<int> &GetEdgeDistances() const;
+    // Расписание для запросов с временем отправления
+    const timetable::Timetable &GetTimetable() const;
+    // Самое раннее прибытие по расписанию; алгоритм выбирается routing_settings.timetable_engine_
+    std::optional<timetable::Journey> GetJourney(const tc::Stop *stop_from, const tc::Stop *stop_to,
+                                                double depart_at) const;
+    // До count простых маршрутов по возрастанию времени, не длиннее max_stretch * кратчайший (алгоритм Йена)
+    std::vector<graph::Router<double>::RouteInfo> GetAlternativeRoutes(const tc::Stop *stop_from,
+                                                                       const tc::Stop *stop_to, size_t count,
+                                                                       double max_stretch) const;
+    // Маршруты, оптимальные по Парето по времени прибытия и числу пересадок (RAPTOR)
+    std::vector<timetable::Journey> GetParetoJourneys(const tc::Stop *stop_from, const tc::Stop *stop_to,
+                                                      std::optional<double> depart_at, size_t max_transfers) const;
+    const RoutingSettings &GetRoutingSettings() const;
+    // Номер построения маршрутизатора, уникальный в пределах процесса и возрастающий
+    uint64_t GetGeneration() const;
 
   private:
+    static uint64_t NextGeneration();
     void AddEdgesGraph(const TransportCatalogue &catalogue);
     void BuildGraph(const TransportCatalogue &catalogue);
+    // Предрасчёт для запросов маршрута по routing_settings_.route_engine_
+    void BuildRouteEngine();
+    void BuildTimetable(const TransportCatalogue &catalogue);
+    void BuildLandmarks();
+    // Нижняя оценка времени в пути от vertex до вершины ожидания остановки stop_to
+    double GetLowerBound(graph::VertexId vertex, graph::VertexId vertex_to, const Stop *stop_to) const;
 
     graph::DirectedWeightedGraph<double> graph_;
     std::unique_ptr<graph::Router<double>> router_;
+    std::unique_ptr<graph::LandmarkIndex<double>> landmarks_;
+    std::unique_ptr<graph::Overlay<double>> overlay_;
+    // Минут на метр по прямой: не больше, чем у любого перегона, поэтому оценка по координатам допустима
+    double geo_time_factor_ = 0.0;
+    std::shared_ptr<const image::CatalogueImage> image_;
+    std::shared_ptr<const timetable::Timetable> timetable_;
+    std::shared_ptr<const timetable::ConnectionScan> connection_scan_;
+    std::map<const tc::Stop *, graph::VertexId> stop_to_vertex_id_;
+    std::vector<const tc::Stop *> vertex_stops_; // Остановка вершины ожидания 2 * i — vertex_stops_[i]
+    std::vector<int> edge_distances_;             // Длина ребра в метрах; у рёбер ожидания 0
+    uint64_t generation_;
     RoutingSettings routing_settings_;
 };
-} // namespace tc
\ No newline at end of file
+} // namespace tc
@@ -0,0 +1,744 @@
+#include "../include/catalogue_image.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace std::literals;
+
+namespace image
+{
+namespace
+{
+size_t AlignUp(size_t value)
+{
+    return (value + 7) & ~static_cast<size_t>(7);
+}
+
+// Таблица маршрутов в сумму не входит: при открытии её страницы не читаются, ячейки проверяются при обходе
+uint64_t ComputeChecksum(std::string_view data)
+{
+    constexpr size_t checksum_begin = offsetof(Header, checksum);
+    constexpr size_t checksum_end = checksum_begin + sizeof(Header::checksum);
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        const uint8_t byte = i >= checksum_begin && i < checksum_end ? 0 : static_cast<uint8_t>(data[i]);
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+std::runtime_error SystemError(const std::string &what, const std::string &path)
+{
+    return std::runtime_error(what + " '"s + path + "': "s + std::strerror(errno));
+}
+
+class ImageBuilder
+{
+  public:
+    StringRef AddString(std::string_view str)
+    {
+        if (const auto it = string_refs_.find(std::string(str)); it != string_refs_.end())
+        {
+            return it->second;
+        }
+
+        StringRef ref{strings_.size(), str.size()};
+        strings_.append(str);
+        string_refs_.emplace(std::string(str), ref);
+
+        return ref;
+    }
+
+    template <typename T> Section AddSection(const std::vector<T> &records)
+    {
+        const size_t offset = AlignUp(body_.size());
+        body_.resize(offset);
+        body_.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(T));
+
+        return {sizeof(Header) + offset, records.size()};
+    }
+
+    // Секция, записи которой пишутся в файл сразу за результатом Finish; добавляется последней
+    Section AddTrailingSection(size_t count)
+    {
+        const size_t offset = AlignUp(body_.size());
+        body_.resize(offset);
+
+        return {sizeof(Header) + offset, count};
+    }
+
+    Section AddStrings()
+    {
+        const size_t offset = AlignUp(body_.size());
+        body_.resize(offset);
+        body_.append(strings_);
+
+        return {sizeof(Header) + offset, strings_.size()};
+    }
+
+    std::string Finish(const Header &header) const
+    {
+        std::string result(reinterpret_cast<const char *>(&header), sizeof(Header));
+        result.append(body_);
+
+        return result;
+    }
+
+  private:
+    std::string strings_;
+    std::unordered_map<std::string, StringRef> string_refs_;
+    std::string body_;
+};
+
+// Файл образа, который пишется частями через буфер и перед закрытием сбрасывается на диск
+class ImageFile
+{
+  public:
+    explicit ImageFile(std::string path)
+        : path_(std::move(path)), fd_(::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644))
+    {
+        if (fd_ < 0)
+        {
+            throw SystemError("failed to create image"s, path_);
+        }
+    }
+
+    ImageFile(const ImageFile &) = delete;
+    ImageFile &operator=(const ImageFile &) = delete;
+
+    ~ImageFile()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+
+    void Write(std::string_view data)
+    {
+        buffer_.append(data);
+
+        if (buffer_.size() >= BUFFER_SIZE)
+        {
+            Flush();
+        }
+    }
+
+    void Close()
+    {
+        Flush();
+
+        if (::fsync(fd_) != 0)
+        {
+            throw SystemError("failed to sync image"s, path_);
+        }
+
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+  private:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    void Flush()
+    {
+        std::string_view data = buffer_;
+
+        while (!data.empty())
+        {
+            const ssize_t n = ::write(fd_, data.data(), data.size());
+
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (n < 0)
+            {
+                throw SystemError("failed to write image"s, path_);
+            }
+
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+
+        buffer_.clear();
+    }
+
+    std::string path_;
+    int fd_;
+    std::string buffer_;
+};
+} // namespace
+
+CatalogueImage::CatalogueImage(const std::string &path) : path_(path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        throw SystemError("failed to open image"s, path);
+    }
+
+    struct stat st;
+
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw SystemError("failed to stat image"s, path);
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+
+    if (size_ < sizeof(Header))
+    {
+        ::close(fd);
+        throw std::runtime_error("image '"s + path + "' is truncated"s);
+    }
+
+    void *data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        throw SystemError("failed to map image"s, path);
+    }
+
+    data_ = static_cast<const char *>(data);
+    header_ = reinterpret_cast<const Header *>(data_);
+
+    if (std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0 || header_->version != VERSION)
+    {
+        ::munmap(const_cast<char *>(data_), size_);
+        throw std::runtime_error("image '"s + path + "' has unsupported format"s);
+    }
+
+    try
+    {
+        Validate();
+    }
+    catch (...)
+    {
+        ::munmap(const_cast<char *>(data_), size_);
+        throw;
+    }
+}
+
+/*
+ * Проверяет контрольную сумму, смещения, индексы и ссылки на строки: испорченный или чужой файл отвергается
+ * при открытии, а не приводит к чтению за пределами отображения при запросе. Таблицу маршрутов открытие
+ * не читает, чтобы её страницы оставались общими и подгружались по запросам: её ячейки проверяет BuildRoute
+ */
+void CatalogueImage::Validate() const
+{
+    const auto corrupted = [this] { return std::runtime_error("image '"s + path_ + "' is corrupted"s); };
+    const std::pair<const Section *, size_t> sections[] = {
+        {&header_->stops, sizeof(StopRecord)},
+        {&header_->buses, sizeof(BusRecord)},
+        {&header_->bus_stops, sizeof(uint32_t)},
+        {&header_->distances, sizeof(DistanceRecord)},
+        {&header_->schedules, sizeof(ScheduleRecord)},
+        {&header_->edges, sizeof(EdgeRecord)},
+        {&header_->routes, sizeof(RouteCell)},
+    };
+
+    if (header_->strings.offset > size_ || header_->strings.count > size_ - header_->strings.offset)
+    {
+        throw corrupted();
+    }
+
+    for (const auto &[section, record_size] : sections)
+    {
+        if (section->offset > size_ || section->offset % alignof(uint64_t) != 0 ||
+            section->count > (size_ - section->offset) / record_size)
+        {
+            throw corrupted();
+        }
+    }
+
+    if (header_->checksum != ComputeChecksum({data_, header_->routes.offset}))
+    {
+        throw corrupted();
+    }
+
+    const uint64_t stop_count = header_->stops.count;
+    const uint64_t vertex_count = header_->vertex_count;
+    const auto is_valid_string = [this](const StringRef &ref) {
+        return ref.offset <= header_->strings.count && ref.length <= header_->strings.count - ref.offset;
+    };
+
+    // Таблица маршрутов записывается только для RouteEngine::ALL_PAIRS
+    const bool is_valid_table = !HasRouteTable() || vertex_count == 0
+                                    ? header_->routes.count == 0
+                                    : header_->routes.count % vertex_count == 0 &&
+                                          header_->routes.count / vertex_count == vertex_count;
+
+    if (header_->route_engine > static_cast<uint32_t>(tc::RouteEngine::CRP) ||
+        header_->timetable_engine > static_cast<uint32_t>(tc::TimetableEngine::CONNECTION_SCAN) ||
+        header_->build_threads == 0 || header_->cell_size == 0 || header_->walk_stop_count == 0)
+    {
+        throw corrupted();
+    }
+
+    if (vertex_count != stop_count * 2 || !is_valid_string(header_->render_settings) || !is_valid_table)
+    {
+        throw corrupted();
+    }
+
+    // Остановки записаны по возрастанию названия: вершины остановок однозначны
+    const StopRecord *stops = GetSection<StopRecord>(header_->stops);
+
+    for (uint64_t i = 0; i < stop_count; ++i)
+    {
+        if (!is_valid_string(stops[i].name) || (i > 0 && !(GetString(stops[i - 1].name) < GetString(stops[i].name))))
+        {
+            throw corrupted();
+        }
+    }
+
+    const BusRecord *buses = GetSection<BusRecord>(header_->buses);
+
+    for (uint64_t i = 0; i < header_->buses.count; ++i)
+    {
+        if (!is_valid_string(buses[i].number) ||
+            buses[i].stops_begin + static_cast<uint64_t>(buses[i].stops_count) > header_->bus_stops.count)
+        {
+            throw corrupted();
+        }
+    }
+
+    const uint32_t *bus_stops = GetSection<uint32_t>(header_->bus_stops);
+
+    if (std::any_of(bus_stops, bus_stops + header_->bus_stops.count,
+                    [stop_count](uint32_t stop) { return stop >= stop_count; }))
+    {
+        throw corrupted();
+    }
+
+    const DistanceRecord *distances = GetSection<DistanceRecord>(header_->distances);
+
+    if (std::any_of(distances, distances + header_->distances.count, [stop_count](const DistanceRecord &distance) {
+            return distance.from >= stop_count || distance.to >= stop_count;
+        }))
+    {
+        throw corrupted();
+    }
+
+    const ScheduleRecord *schedules = GetSection<ScheduleRecord>(header_->schedules);
+
+    if (std::any_of(schedules, schedules + header_->schedules.count,
+                    [&](const ScheduleRecord &schedule) { return !is_valid_string(schedule.bus); }))
+    {
+        throw corrupted();
+    }
+
+    const EdgeRecord *edges = GetSection<EdgeRecord>(header_->edges);
+
+    if (std::any_of(edges, edges + header_->edges.count, [&](const EdgeRecord &edge) {
+            return !is_valid_string(edge.name) || edge.from >= vertex_count || edge.to >= vertex_count;
+        }))
+    {
+        throw corrupted();
+    }
+}
+
+CatalogueImage::~CatalogueImage()
+{
+    ::munmap(const_cast<char *>(data_), size_);
+}
+
+template <typename T> const T *CatalogueImage::GetSection(const Section &section) const
+{
+    return reinterpret_cast<const T *>(data_ + section.offset);
+}
+
+std::string_view CatalogueImage::GetString(const StringRef &ref) const
+{
+    return {GetSection<char>(header_->strings) + ref.offset, ref.length};
+}
+
+const std::string &CatalogueImage::GetPath() const
+{
+    return path_;
+}
+
+size_t CatalogueImage::GetStopCount() const
+{
+    return header_->stops.count;
+}
+
+std::string_view CatalogueImage::GetStopName(size_t index) const
+{
+    return GetString(GetSection<StopRecord>(header_->stops)[index].name);
+}
+
+size_t CatalogueImage::GetVertexCount() const
+{
+    return header_->vertex_count;
+}
+
+tc::RoutingSettings CatalogueImage::GetRoutingSettings() const
+{
+    tc::RoutingSettings routing_settings;
+    routing_settings.bus_wait_time_ = header_->bus_wait_time;
+    routing_settings.bus_velocity_ = header_->bus_velocity;
+    routing_settings.build_threads_ = header_->build_threads;
+    routing_settings.timetable_engine_ = static_cast<tc::TimetableEngine>(header_->timetable_engine);
+    routing_settings.route_engine_ = static_cast<tc::RouteEngine>(header_->route_engine);
+    routing_settings.landmark_count_ = header_->landmark_count;
+    routing_settings.cell_size_ = header_->cell_size;
+    routing_settings.walk_speed_ = header_->walk_speed;
+    routing_settings.walk_stop_count_ = header_->walk_stop_count;
+    routing_settings.walk_radius_ = header_->walk_radius;
+
+    const ScheduleRecord *schedules = GetSection<ScheduleRecord>(header_->schedules);
+
+    for (size_t i = 0; i < header_->schedules.count; ++i)
+    {
+        routing_settings.bus_schedules_[std::string(GetString(schedules[i].bus))].push_back(
+            {schedules[i].from, schedules[i].to, schedules[i].interval});
+    }
+
+    return routing_settings;
+}
+
+uint64_t CatalogueImage::GetLogGeneration() const
+{
+    return header_->log_generation;
+}
+
+uint64_t CatalogueImage::GetLogRecords() const
+{
+    return header_->log_records;
+}
+
+std::string_view CatalogueImage::GetRenderSettings() const
+{
+    return GetString(header_->render_settings);
+}
+
+void CatalogueImage::FillTransportCatalogue(tc::TransportCatalogue &catalogue) const
+{
+    const StopRecord *stops = GetSection<StopRecord>(header_->stops);
+    std::vector<const tc::Stop *> stop_ptrs;
+    stop_ptrs.reserve(header_->stops.count);
+
+    for (size_t i = 0; i < header_->stops.count; ++i)
+    {
+        catalogue.AddStop({GetString(stops[i].name), {stops[i].lat, stops[i].lng}, {}});
+        stop_ptrs.push_back(catalogue.GetStop(GetString(stops[i].name)));
+    }
+
+    const DistanceRecord *distances = GetSection<DistanceRecord>(header_->distances);
+
+    for (size_t i = 0; i < header_->distances.count; ++i)
+    {
+        catalogue.SetDistance(stop_ptrs.at(distances[i].from), stop_ptrs.at(distances[i].to), distances[i].distance);
+    }
+
+    const BusRecord *buses = GetSection<BusRecord>(header_->buses);
+    const uint32_t *bus_stops = GetSection<uint32_t>(header_->bus_stops);
+
+    for (size_t i = 0; i < header_->buses.count; ++i)
+    {
+        tc::Bus bus{GetString(buses[i].number), {}, buses[i].is_roundtrip != 0};
+
+        for (uint32_t j = 0; j < buses[i].stops_count; ++j)
+        {
+            bus.stops.push_back(stop_ptrs.at(bus_stops[buses[i].stops_begin + j]));
+        }
+
+        catalogue.AddBus(std::move(bus));
+    }
+}
+
+graph::DirectedWeightedGraph<double> CatalogueImage::MakeGraph() const
+{
+    graph::DirectedWeightedGraph<double> graph(header_->vertex_count);
+    const EdgeRecord *edges = GetSection<EdgeRecord>(header_->edges);
+    // Строки в образе не повторяются, поэтому название ищется в хранилище один раз на смещение, а не на ребро
+    std::unordered_map<uint64_t, names::Name> edge_names;
+
+    for (size_t i = 0; i < header_->edges.count; ++i)
+    {
+        auto [it, inserted] = edge_names.try_emplace(edges[i].name.offset);
+
+        if (inserted)
+        {
+            it->second = GetString(edges[i].name);
+        }
+
+        graph.AddEdge({it->second, edges[i].span_count, edges[i].from, edges[i].to, edges[i].weight});
+    }
+
+    return graph;
+}
+
+std::vector<int> CatalogueImage::GetEdgeDistances() const
+{
+    const EdgeRecord *edges = GetSection<EdgeRecord>(header_->edges);
+    std::vector<int> distances;
+    distances.reserve(header_->edges.count);
+
+    for (size_t i = 0; i < header_->edges.count; ++i)
+    {
+        distances.push_back(edges[i].distance);
+    }
+
+    return distances;
+}
+
+bool CatalogueImage::HasRouteTable() const
+{
+    return header_->route_engine == static_cast<uint32_t>(tc::RouteEngine::ALL_PAIRS);
+}
+
+const RouteCell *CatalogueImage::GetRouteRow(graph::VertexId from) const
+{
+    return GetSection<RouteCell>(header_->routes) + from * header_->vertex_count;
+}
+
+std::optional<graph::Router<double>::RouteInfo> CatalogueImage::BuildRoute(graph::VertexId from,
+                                                                            graph::VertexId to) const
+{
+    const size_t vertex_count = header_->vertex_count;
+
+    if (from >= vertex_count || to >= vertex_count)
+    {
+        throw std::out_of_range("vertex is out of image range"s);
+    }
+
+    const RouteCell *routes = GetSection<RouteCell>(header_->routes) + from * vertex_count;
+    const EdgeRecord *edges = GetSection<EdgeRecord>(header_->edges);
+
+    if (!routes[to].has_route)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<graph::EdgeId> route_edges;
+    graph::VertexId vertex = to;
+
+    // Ребро ячейки должно вести в её вершину, а цепочка — закончиться в from. В кратчайшем пути меньше рёбер,
+    // чем вершин: иначе цепочка рёбер в таблице замкнулась
+    for (uint32_t edge_id = routes[vertex].prev_edge; edge_id != NO_INDEX; edge_id = routes[vertex].prev_edge)
+    {
+        if (edge_id >= header_->edges.count || edges[edge_id].to != vertex || route_edges.size() == vertex_count)
+        {
+            throw std::runtime_error("image '"s + path_ + "' is corrupted"s);
+        }
+
+        route_edges.push_back(edge_id);
+        vertex = edges[edge_id].from;
+    }
+
+    if (vertex != from)
+    {
+        throw std::runtime_error("image '"s + path_ + "' is corrupted"s);
+    }
+
+    std::reverse(route_edges.begin(), route_edges.end());
+
+    return graph::Router<double>::RouteInfo{routes[to].weight, std::move(route_edges)};
+}
+
+std::optional<double> CatalogueImage::GetRouteWeight(graph::VertexId from, graph::VertexId to) const
+{
+    const size_t vertex_count = header_->vertex_count;
+
+    if (from >= vertex_count || to >= vertex_count)
+    {
+        throw std::out_of_range("vertex is out of image range"s);
+    }
+
+    const RouteCell &cell = GetSection<RouteCell>(header_->routes)[from * vertex_count + to];
+
+    return cell.has_route ? std::optional<double>(cell.weight) : std::nullopt;
+}
+
+void WriteImage(const std::string &path, const tc::TransportCatalogue &catalogue, const tc::TransportRouter &router,
+                std::string_view render_settings, uint64_t log_generation, uint64_t log_records)
+{
+    const tc::RoutingSettings &routing_settings = router.GetRoutingSettings();
+    // Таблица маршрутов пишется только для RouteEngine::ALL_PAIRS: из построенного маршрутизатора или из образа,
+    // по которому он отвечает. Остальные способы образ не хранит, их предрасчёт строится при открытии
+    const bool has_route_table = routing_settings.route_engine_ == tc::RouteEngine::ALL_PAIRS;
+    const graph::Router<double> *graph_router = router.GetRouter();
+    const CatalogueImage *source_image = router.GetImage();
+
+    if (has_route_table && !graph_router && !source_image)
+    {
+        throw std::logic_error("router has no route table to write");
+    }
+
+    ImageBuilder builder;
+    std::unordered_map<const tc::Stop *, uint32_t> stop_index;
+    std::vector<StopRecord> stops;
+
+    for (const auto &[name, stop] : catalogue.GetAllStops())
+    {
+        stop_index[stop] = static_cast<uint32_t>(stops.size());
+        stops.push_back({builder.AddString(name), stop->coordinates.lat, stop->coordinates.lng});
+    }
+
+    std::vector<BusRecord> buses;
+    std::vector<uint32_t> bus_stops;
+
+    for (const auto &[number, bus] : catalogue.GetAllBuses())
+    {
+        buses.push_back({builder.AddString(number), static_cast<uint32_t>(bus_stops.size()),
+                         static_cast<uint32_t>(bus->stops.size()), bus->is_roundtrip, 0});
+
+        for (const tc::Stop *stop : bus->stops)
+        {
+            bus_stops.push_back(stop_index.at(stop));
+        }
+    }
+
+    std::vector<DistanceRecord> distances;
+
+    for (const auto &[stops_pair, distance] : catalogue.GetAllDistances())
+    {
+        distances.push_back({stop_index.at(stops_pair.first), stop_index.at(stops_pair.second), distance, 0});
+    }
+
+    std::sort(distances.begin(), distances.end(), [](const DistanceRecord &lhs, const DistanceRecord &rhs) {
+        return std::pair{lhs.from, lhs.to} < std::pair{rhs.from, rhs.to};
+    });
+
+    std::vector<ScheduleRecord> schedules;
+
+    for (const auto &[bus, headways] : routing_settings.bus_schedules_)
+    {
+        const StringRef bus_ref = builder.AddString(bus);
+
+        for (const tc::Headway &headway : headways)
+        {
+            schedules.push_back({bus_ref, headway.from, headway.to, headway.interval});
+        }
+    }
+
+    const auto &graph = router.GetRouteGraph();
+    const std::vector<int> &edge_distances = router.GetEdgeDistances();
+
+    // Граф, построенный до PUT/PATCH, не соответствует справочнику: такой образ не откроется
+    bool is_graph_of_catalogue = graph.GetVertexCount() == stops.size() * 2;
+    graph::VertexId vertex = 0;
+
+    for (const auto &[name, stop] : catalogue.GetAllStops())
+    {
+        if (!is_graph_of_catalogue || std::string_view(router.GetVertexStop(vertex)->name) != name)
+        {
+            is_graph_of_catalogue = false;
+            break;
+        }
+
+        vertex += 2;
+    }
+
+    if (!is_graph_of_catalogue)
+    {
+        throw std::logic_error("route graph does not match the catalogue"s);
+    }
+    std::vector<EdgeRecord> edges;
+    edges.reserve(graph.GetEdgeCount());
+
+    for (graph::EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id)
+    {
+        const auto &edge = graph.GetEdge(edge_id);
+        edges.push_back({builder.AddString(edge.name), static_cast<uint32_t>(edge.span_count),
+                         edge_distances.at(edge_id), static_cast<uint32_t>(edge.from), static_cast<uint32_t>(edge.to),
+                         edge.weight});
+    }
+
+    const size_t vertex_count = graph.GetVertexCount();
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.bus_wait_time = routing_settings.bus_wait_time_;
+    header.bus_velocity = routing_settings.bus_velocity_;
+    header.build_threads = routing_settings.build_threads_;
+    header.vertex_count = vertex_count;
+    header.log_generation = log_generation;
+    header.log_records = log_records;
+    header.route_engine = static_cast<uint32_t>(routing_settings.route_engine_);
+    header.timetable_engine = static_cast<uint32_t>(routing_settings.timetable_engine_);
+    header.landmark_count = routing_settings.landmark_count_;
+    header.cell_size = routing_settings.cell_size_;
+    header.walk_speed = routing_settings.walk_speed_;
+    header.walk_stop_count = routing_settings.walk_stop_count_;
+    header.walk_radius = routing_settings.walk_radius_;
+    header.render_settings = builder.AddString(render_settings);
+    header.stops = builder.AddSection(stops);
+    header.buses = builder.AddSection(buses);
+    header.bus_stops = builder.AddSection(bus_stops);
+    header.distances = builder.AddSection(distances);
+    header.schedules = builder.AddSection(schedules);
+    header.edges = builder.AddSection(edges);
+    header.strings = builder.AddStrings();
+    header.routes = builder.AddTrailingSection(has_route_table ? vertex_count * vertex_count : 0);
+
+    const std::string tmp_path = path + ".tmp"s;
+    ImageFile file(tmp_path);
+    std::string head = builder.Finish(header);
+    const uint64_t checksum = ComputeChecksum(head);
+    std::memcpy(head.data() + offsetof(Header, checksum), &checksum, sizeof(checksum));
+    file.Write(head);
+
+    // Таблица маршрутов — квадратичная часть образа: пишется по строке, не собираясь в памяти целиком
+    std::vector<RouteCell> row(vertex_count);
+
+    for (graph::VertexId from = 0; has_route_table && from < vertex_count; ++from)
+    {
+        if (source_image)
+        {
+            file.Write(
+                {reinterpret_cast<const char *>(source_image->GetRouteRow(from)), vertex_count * sizeof(RouteCell)});
+            continue;
+        }
+
+        for (graph::VertexId to = 0; to < vertex_count; ++to)
+        {
+            const auto data = graph_router->GetRouteData(from, to);
+            row[to] = data ? RouteCell{data->first, data->second ? static_cast<uint32_t>(*data->second) : NO_INDEX, 1}
+                           : RouteCell{0.0, NO_INDEX, 0};
+        }
+
+        file.Write({reinterpret_cast<const char *>(row.data()), row.size() * sizeof(RouteCell)});
+    }
+
+    file.Close();
+    ReplaceImage(tmp_path, path);
+}
+
+void ReplaceImage(const std::string &tmp_path, const std::string &path)
+{
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        throw SystemError("failed to replace image"s, path);
+    }
+
+    // Переименование должно пережить сбой раньше, чем журнал изменений будет очищен
+    const auto slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "."s : path.substr(0, slash + 1);
+
+    if (const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY); dir_fd >= 0)
+    {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+} // namespace image
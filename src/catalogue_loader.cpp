@@ -0,0 +1,172 @@
+#include "../include/catalogue_loader.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <sstream>
+
+namespace loader
+{
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double MillisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Очередь фиксированной ёмкости между разбором и построением справочника
+template <typename T> class BoundedQueue
+{
+  public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity)
+    {
+    }
+
+    // Возвращает false, если очередь закрыта (потребитель завершился)
+    bool Push(T value)
+    {
+        std::unique_lock lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+
+        if (closed_)
+        {
+            return false;
+        }
+
+        items_.push_back(std::move(value));
+        not_empty_.notify_one();
+
+        return true;
+    }
+
+    std::optional<T> Pop()
+    {
+        std::unique_lock lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+
+        if (items_.empty())
+        {
+            return std::nullopt;
+        }
+
+        T value = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+
+        return value;
+    }
+
+    void Close()
+    {
+        std::lock_guard lock(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+  private:
+    size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+} // namespace
+
+LoadResult LoadCatalogue(std::istream &input, size_t queue_capacity)
+{
+    const auto start = Clock::now();
+    LoadResult result;
+    result.catalogue = std::make_unique<tc::TransportCatalogue>();
+    result.json_reader = std::make_unique<json_reader::JsonReader>();
+
+    BoundedQueue<json::Node> queue(queue_capacity);
+
+    auto build = std::async(std::launch::async, [&queue, &result, start] {
+        try
+        {
+            while (auto request = queue.Pop())
+            {
+                result.json_reader->AddBaseRequest(*request, *result.catalogue);
+            }
+
+            result.json_reader->FinishTransportCatalogue(*result.catalogue);
+        }
+        catch (...)
+        {
+            queue.Close();
+            throw;
+        }
+
+        result.timings.build = MillisecondsSince(start);
+    });
+
+    json::Document document;
+    bool is_builder_stopped = false;
+
+    try
+    {
+        document = json::LoadStreaming(input, "base_requests"s, [&queue, &is_builder_stopped](json::Node request) {
+            if (!queue.Push(std::move(request)))
+            {
+                is_builder_stopped = true;
+                throw std::runtime_error("catalogue builder has stopped"s);
+            }
+        });
+    }
+    catch (...)
+    {
+        queue.Close();
+
+        // Построитель останавливается только с исключением: оно и объясняет, что не так во входных данных
+        if (is_builder_stopped)
+        {
+            build.get();
+        }
+
+        else
+        {
+            build.wait();
+        }
+
+        throw;
+    }
+
+    queue.Close();
+    result.timings.parse = MillisecondsSince(start);
+
+    // Параметры читаются, пока построитель дописывает расстояния и маршруты
+    const auto settings_start = Clock::now();
+    const auto &root = document.GetRoot().AsDict();
+    result.renderer = std::make_unique<renderer::MapRenderer>(
+        result.json_reader->FillRenderSettings(root.at("render_settings"s)));
+    const auto routing_settings = result.json_reader->FillRoutingSettings(root.at("routing_settings"s));
+    result.timings.settings = MillisecondsSince(settings_start);
+
+    build.get();
+    result.json_reader->SetDocument(std::move(document));
+
+    const auto router_start = Clock::now();
+    auto router = std::async(std::launch::async, [&result, &routing_settings, router_start] {
+        result.router = std::make_unique<tc::TransportRouter>(routing_settings, *result.catalogue);
+        result.timings.router = MillisecondsSince(router_start);
+    });
+
+    const auto map_start = Clock::now();
+    std::ostringstream map;
+    result.renderer->GetSVG(result.catalogue->GetAllBuses()).Render(map);
+    result.map_svg = map.str();
+    result.timings.map = MillisecondsSince(map_start);
+
+    router.get();
+    result.timings.total = MillisecondsSince(start);
+
+    return result;
+}
+} // namespace loader
@@ -0,0 +1,154 @@
+#include "../include/connection_scan.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+namespace timetable
+{
+namespace
+{
+constexpr double UNREACHED = std::numeric_limits<double>::infinity();
+constexpr uint32_t NO_CONNECTION = std::numeric_limits<uint32_t>::max();
+
+struct Connection
+{
+    double departure_time;
+    double arrival_time;
+    uint32_t departure_stop;
+    uint32_t arrival_stop;
+    uint32_t trip;
+    uint32_t position;
+};
+} // namespace
+
+ConnectionScan::ConnectionScan(const Timetable &timetable) : timetable_(timetable)
+{
+    std::vector<Connection> connections;
+    const auto &lines = timetable.GetLines();
+
+    for (uint32_t line_index = 0; line_index < lines.size(); ++line_index)
+    {
+        const Line &line = lines[line_index];
+
+        for (const double departure : line.departures)
+        {
+            const uint32_t trip = static_cast<uint32_t>(trip_lines_.size());
+            trip_lines_.push_back(line_index);
+
+            for (uint32_t i = 0; i + 1 < line.stops.size(); ++i)
+            {
+                connections.push_back({departure + line.offsets[i], departure + line.offsets[i + 1], line.stops[i],
+                                       line.stops[i + 1], trip, i});
+            }
+        }
+    }
+
+    if (connections.size() >= NO_CONNECTION)
+    {
+        throw std::length_error("too many connections in timetable");
+    }
+
+    // При равном времени отправления связи одного рейса идут по порядку, иначе рейс нельзя продолжить
+    std::sort(connections.begin(), connections.end(), [](const Connection &lhs, const Connection &rhs) {
+        return std::tie(lhs.departure_time, lhs.trip, lhs.position) <
+               std::tie(rhs.departure_time, rhs.trip, rhs.position);
+    });
+
+    departure_times_.reserve(connections.size());
+    arrival_times_.reserve(connections.size());
+    departure_stops_.reserve(connections.size());
+    arrival_stops_.reserve(connections.size());
+    trips_.reserve(connections.size());
+    positions_.reserve(connections.size());
+
+    for (const Connection &connection : connections)
+    {
+        departure_times_.push_back(connection.departure_time);
+        arrival_times_.push_back(connection.arrival_time);
+        departure_stops_.push_back(connection.departure_stop);
+        arrival_stops_.push_back(connection.arrival_stop);
+        trips_.push_back(connection.trip);
+        positions_.push_back(connection.position);
+    }
+}
+
+size_t ConnectionScan::GetConnectionCount() const
+{
+    return departure_times_.size();
+}
+
+std::optional<Journey> ConnectionScan::FindEarliestArrival(const tc::Stop *from, const tc::Stop *to,
+                                                           double depart_at) const
+{
+    const auto source = timetable_.FindStopIndex(from);
+    const auto target = timetable_.FindStopIndex(to);
+
+    if (!source || !target)
+    {
+        throw std::out_of_range("stop is not in timetable");
+    }
+
+    std::vector<double> arrivals(timetable_.GetStopCount(), UNREACHED);
+    std::vector<uint32_t> trip_entries(trip_lines_.size(), NO_CONNECTION);
+    // Связи посадки и высадки, которыми достигнута остановка
+    std::vector<std::pair<uint32_t, uint32_t>> parents(timetable_.GetStopCount(), {NO_CONNECTION, NO_CONNECTION});
+
+    arrivals[*source] = depart_at;
+
+    const size_t first = std::lower_bound(departure_times_.begin(), departure_times_.end(), depart_at) -
+                         departure_times_.begin();
+
+    for (size_t connection = first; connection < departure_times_.size(); ++connection)
+    {
+        // Все следующие связи отправляются не раньше уже найденного прибытия
+        if (arrivals[*target] <= departure_times_[connection])
+        {
+            break;
+        }
+
+        uint32_t &entry = trip_entries[trips_[connection]];
+
+        if (entry == NO_CONNECTION)
+        {
+            if (arrivals[departure_stops_[connection]] > departure_times_[connection])
+            {
+                continue;
+            }
+
+            entry = static_cast<uint32_t>(connection);
+        }
+
+        const uint32_t arrival_stop = arrival_stops_[connection];
+
+        if (arrival_times_[connection] < arrivals[arrival_stop])
+        {
+            arrivals[arrival_stop] = arrival_times_[connection];
+            parents[arrival_stop] = {entry, static_cast<uint32_t>(connection)};
+        }
+    }
+
+    if (arrivals[*target] == UNREACHED)
+    {
+        return std::nullopt;
+    }
+
+    Journey journey{depart_at, arrivals[*target], {}};
+
+    for (uint32_t stop = *target; parents[stop].first != NO_CONNECTION;)
+    {
+        const auto [entry, exit] = parents[stop];
+        const Line &line = timetable_.GetLines()[trip_lines_[trips_[entry]]];
+
+        journey.legs.push_back({line.bus, timetable_.GetStop(departure_stops_[entry]), timetable_.GetStop(stop),
+                                positions_[exit] - positions_[entry] + 1, departure_times_[entry],
+                                arrival_times_[exit]});
+        stop = departure_stops_[entry];
+    }
+
+    std::reverse(journey.legs.begin(), journey.legs.end());
+
+    return journey;
+}
+} // namespace timetable
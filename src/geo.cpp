@@ -1,8 +1,37 @@
 #include "../include/geo.h"
+#include <algorithm>
 #include <cmath>
 
 namespace geo
 {
+namespace
+{
+// То же приближение числа пи, что в ComputeDistance, чтобы пакетный и поштучный расчёты совпадали
+const double DEGREES_TO_RADIANS = 3.1415926535 / 180.;
+
+// Длина дуги в метрах по хорде единичной сферы
+double ChordToArc(double chord)
+{
+    const double square = chord * chord;
+
+    return EARTH_RADIUS * chord * (1.0 + square * (1.0 / 24 + square * (3.0 / 640 + square * (5.0 / 7168))));
+}
+
+// Дуги, для которых ряд неточен, пересчитываются точным asin; хорда восстанавливается по векторам
+template <typename ChordFunction> void FixLongArcs(std::vector<double> &distances, ChordFunction chord)
+{
+    const double max_series_arc = ChordToArc(CoordinateBatch::MAX_SERIES_CHORD);
+
+    for (size_t i = 0; i < distances.size(); ++i)
+    {
+        if (distances[i] > max_series_arc)
+        {
+            distances[i] = EARTH_RADIUS * 2.0 * std::asin(std::min(1.0, chord(i) / 2.0));
+        }
+    }
+}
+} // namespace
+
 double ComputeDistance(Coordinates from, Coordinates to)
 {
     using namespace std;
@@ -18,4 +47,108 @@ double ComputeDistance(Coordinates from, Coordinates to)
                 cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr)) *
            6371000;
 }
+
+SpherePoint ToSpherePoint(Coordinates point)
+{
+    const double lat = point.lat * DEGREES_TO_RADIANS;
+    const double lng = point.lng * DEGREES_TO_RADIANS;
+
+    return {std::cos(lat) * std::cos(lng), std::cos(lat) * std::sin(lng), std::sin(lat)};
+}
+
+double ComputeDistance(const SpherePoint &from, const SpherePoint &to)
+{
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double dz = to.z - from.z;
+    const double chord = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+    return chord <= CoordinateBatch::MAX_SERIES_CHORD ? ChordToArc(chord)
+                                                      : EARTH_RADIUS * 2.0 * std::asin(std::min(1.0, chord / 2.0));
+}
+
+double DistanceToChord(double distance)
+{
+    return 2.0 * std::sin(std::min(distance / EARTH_RADIUS, 3.1415926535) / 2.0);
+}
+
+CoordinateBatch::CoordinateBatch(const std::vector<Coordinates> &points)
+{
+    x_.reserve(points.size());
+    y_.reserve(points.size());
+    z_.reserve(points.size());
+
+    for (const Coordinates &point : points)
+    {
+        Add(point);
+    }
+}
+
+void CoordinateBatch::Add(Coordinates point)
+{
+    Add(ToSpherePoint(point));
+}
+
+void CoordinateBatch::Add(const SpherePoint &point)
+{
+    x_.push_back(point.x);
+    y_.push_back(point.y);
+    z_.push_back(point.z);
+}
+
+size_t CoordinateBatch::GetSize() const
+{
+    return x_.size();
+}
+
+void CoordinateBatch::ComputeDistancesTo(Coordinates point, std::vector<double> &distances) const
+{
+    ComputeDistancesTo(ToSpherePoint(point), distances);
+}
+
+void CoordinateBatch::ComputeDistancesTo(const SpherePoint &origin, std::vector<double> &distances) const
+{
+    const size_t size = x_.size();
+    const double *x = x_.data();
+    const double *y = y_.data();
+    const double *z = z_.data();
+    distances.resize(size);
+    double *out = distances.data();
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        const double dx = x[i] - origin.x;
+        const double dy = y[i] - origin.y;
+        const double dz = z[i] - origin.z;
+        out[i] = ChordToArc(std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+
+    FixLongArcs(distances, [&](size_t i) {
+        return std::sqrt((x[i] - origin.x) * (x[i] - origin.x) + (y[i] - origin.y) * (y[i] - origin.y) +
+                         (z[i] - origin.z) * (z[i] - origin.z));
+    });
+}
+
+void CoordinateBatch::ComputeSegmentDistances(std::vector<double> &distances) const
+{
+    const size_t size = x_.empty() ? 0 : x_.size() - 1;
+    const double *x = x_.data();
+    const double *y = y_.data();
+    const double *z = z_.data();
+    distances.resize(size);
+    double *out = distances.data();
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        const double dx = x[i + 1] - x[i];
+        const double dy = y[i + 1] - y[i];
+        const double dz = z[i + 1] - z[i];
+        out[i] = ChordToArc(std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+
+    FixLongArcs(distances, [&](size_t i) {
+        return std::sqrt((x[i + 1] - x[i]) * (x[i + 1] - x[i]) + (y[i + 1] - y[i]) * (y[i + 1] - y[i]) +
+                         (z[i + 1] - z[i]) * (z[i + 1] - z[i]));
+    });
+}
 } // namespace geo
\ No newline at end of file
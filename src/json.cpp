@@ -7,7 +7,7 @@ namespace json
 {
 namespace
 {
-Node LoadNode(std::istream &input);
+Node LoadNode(std::istream &input, std::pmr::memory_resource *resource);
 
 std::string LoadLiteral(std::istream &input)
 {
@@ -21,9 +21,9 @@ std::string LoadLiteral(std::istream &input)
     return str;
 }
 
-Node LoadArray(std::istream &input)
+Node LoadArray(std::istream &input, std::pmr::memory_resource *resource)
 {
-    std::vector<Node> result;
+    Array result(resource);
 
     for (char c; input >> c && c != ']';)
     {
@@ -32,7 +32,7 @@ Node LoadArray(std::istream &input)
             input.putback(c);
         }
 
-        result.push_back(LoadNode(input));
+        result.push_back(LoadNode(input, resource));
     }
 
     if (!input)
@@ -233,9 +233,13 @@ Node LoadString(std::istream &input)
     return Node(std::move(s));
 }
 
-Node LoadDict(std::istream &input)
+Node LoadDict(std::istream &input, std::pmr::memory_resource *resource)
 {
-    Dict dict;
+    // Пары собираются в порядке документа и сортируются один раз: вставка каждой в отсортированный
+    // массив сдвигала бы элементы и делала разбор объекта квадратичным. Запас на типичный объект
+    // запроса избавляет от перевыделений при первых полях
+    std::pmr::vector<Dict::value_type> items(resource);
+    items.reserve(8);
 
     for (char c; input >> c && c != '}';)
     {
@@ -244,12 +248,7 @@ Node LoadDict(std::istream &input)
             std::string key = LoadString(input).AsString();
             if (input >> c && c == ':')
             {
-                if (dict.find(key) != dict.end())
-                {
-                    throw ParsingError("Duplicate key '"s + key + "' have been found");
-                }
-
-                dict.emplace(std::move(key), LoadNode(input));
+                items.emplace_back(std::move(key), LoadNode(input, resource));
             }
 
             else
@@ -269,10 +268,10 @@ Node LoadDict(std::istream &input)
         throw ParsingError("Dictionary parsing error"s);
     }
 
-    return Node(std::move(dict));
+    return Node(Dict(std::move(items)));
 }
 
-Node LoadNode(std::istream &input)
+Node LoadNode(std::istream &input, std::pmr::memory_resource *resource)
 {
     char c;
 
@@ -284,10 +283,10 @@ Node LoadNode(std::istream &input)
     switch (c)
     {
     case '[':
-        return LoadArray(input);
+        return LoadArray(input, resource);
 
     case '{':
-        return LoadDict(input);
+        return LoadDict(input, resource);
 
     case '"':
         return LoadString(input);
@@ -444,9 +443,81 @@ bool Node::AsBool() const
     return std::get<bool>(*this);
 }
 
-Document Load(std::istream &input)
+Document Load(std::istream &input, std::pmr::memory_resource *resource)
 {
-    return Document{LoadNode(input)};
+    return Document{LoadNode(input, resource)};
+}
+
+Document LoadStreaming(std::istream &input, const std::string &array_key, const std::function<void(Node)> &on_item)
+{
+    char c;
+
+    if (!(input >> c) || c != '{')
+    {
+        throw ParsingError("Dictionary is expected"s);
+    }
+
+    Dict dict;
+
+    for (; input >> c && c != '}';)
+    {
+        if (c == ',')
+        {
+            continue;
+        }
+
+        if (c != '"')
+        {
+            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+        }
+
+        std::string key = LoadString(input).AsString();
+
+        if (!(input >> c) || c != ':')
+        {
+            throw ParsingError(": is expected but '"s + c + "' has been found"s);
+        }
+
+        if (dict.find(key) != dict.end())
+        {
+            throw ParsingError("Duplicate key '"s + key + "' have been found");
+        }
+
+        if (key != array_key)
+        {
+            dict.emplace(std::move(key), LoadNode(input, std::pmr::get_default_resource()));
+            continue;
+        }
+
+        if (!(input >> c) || c != '[')
+        {
+            throw ParsingError("Array is expected for key '"s + key + "'"s);
+        }
+
+        for (char item; input >> item && item != ']';)
+        {
+            if (item != ',')
+            {
+                input.putback(item);
+            }
+
+            on_item(LoadNode(input, std::pmr::get_default_resource()));
+        }
+
+        if (!input)
+        {
+            throw ParsingError("Array parsing error"s);
+        }
+
+        dict.emplace(std::move(key), Array{});
+    }
+
+    if (!input)
+    {
+        throw ParsingError("Dictionary parsing error"s);
+    }
+
+    return Document{Node(std::move(dict))};
 }
 
 // Контекст вывода, хранит ссылку на поток вывода и текущий отсуп
@@ -596,4 +667,9 @@ void Print(const Document &doc, std::ostream &output)
     PrintNode(doc.GetRoot(), PrintContext{output});
 }
 
+void PrintNode(const Node &node, std::ostream &output, int indent)
+{
+    PrintNode(node, PrintContext{output, 4, indent});
+}
+
 } // namespace json
\ No newline at end of file
@@ -1,11 +1,136 @@
 #include "../include/json_reader.h"
 #include "../include/json_builder.h"
+#include "../include/parallel.h"
+#include <algorithm>
 #include <optional>
+#include <sstream>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
 
 namespace json_reader
 {
 using namespace std::literals;
 
+namespace
+{
+// Печатает ответ как элемент массива ответов и делит текст по значению request_id;
+// nullopt, если целого request_id в тексте нет и подставить другой id некуда
+std::optional<cache::PrintedAnswer> PrintAnswer(const json::Node &answer)
+{
+    std::ostringstream payload;
+    json::PrintNode(answer, payload, 4);
+    std::string text = payload.str();
+
+    // Внутри строк кавычки экранированы, поэтому ключ верхнего уровня находится однозначно
+    const std::string key = "\"request_id\": "s;
+    const size_t key_begin = text.find(key);
+
+    if (key_begin == std::string::npos)
+    {
+        return std::nullopt;
+    }
+
+    const size_t value_begin = key_begin + key.size();
+    const size_t value_end = text.find_first_not_of("-0123456789"s, value_begin);
+
+    if (value_end == std::string::npos || value_end == value_begin)
+    {
+        return std::nullopt;
+    }
+
+    return cache::PrintedAnswer{text.substr(0, value_begin), text.substr(value_end)};
+}
+
+size_t HashNode(const json::Node &node)
+{
+    return std::visit(
+        [](const auto &value) -> size_t {
+            using Value = std::decay_t<decltype(value)>;
+
+            if constexpr (std::is_same_v<Value, std::nullptr_t>)
+            {
+                return 0;
+            }
+
+            else if constexpr (std::is_same_v<Value, json::Array> || std::is_same_v<Value, json::Dict>)
+            {
+                size_t hash = value.size();
+
+                for (const auto &item : value)
+                {
+                    if constexpr (std::is_same_v<Value, json::Dict>)
+                    {
+                        hash = hash * 37 + std::hash<std::string>{}(item.first);
+                        hash = hash * 37 + HashNode(item.second);
+                    }
+
+                    else
+                    {
+                        hash = hash * 37 + HashNode(item);
+                    }
+                }
+
+                return hash;
+            }
+
+            else
+            {
+                return std::hash<Value>{}(value);
+            }
+        },
+        node.GetValue());
+}
+
+// Хэш и равенство запросов пакета по всем полям, кроме id: так запросы сравниваются без печати в текст
+struct RequestHasher
+{
+    size_t operator()(const json::Dict *request) const
+    {
+        size_t hash = 0;
+
+        for (const auto &[key, value] : *request)
+        {
+            if (key != "id"sv)
+            {
+                hash = hash * 37 + std::hash<std::string>{}(key);
+                hash = hash * 37 + HashNode(value);
+            }
+        }
+
+        return hash;
+    }
+};
+
+struct RequestEqual
+{
+    bool operator()(const json::Dict *lhs, const json::Dict *rhs) const
+    {
+        // Поля словаря отсортированы по ключу, поэтому достаточно пройти оба одновременно, пропуская id
+        auto skip_id = [](json::Dict::const_iterator it, json::Dict::const_iterator end) {
+            return it != end && it->first == "id"sv ? std::next(it) : it;
+        };
+
+        auto lhs_it = skip_id(lhs->begin(), lhs->end());
+        auto rhs_it = skip_id(rhs->begin(), rhs->end());
+
+        while (lhs_it != lhs->end() && rhs_it != rhs->end())
+        {
+            if (lhs_it->first != rhs_it->first || lhs_it->second != rhs_it->second)
+            {
+                return false;
+            }
+
+            lhs_it = skip_id(std::next(lhs_it), lhs->end());
+            rhs_it = skip_id(std::next(rhs_it), rhs->end());
+        }
+
+        return lhs_it == lhs->end() && rhs_it == rhs->end();
+    }
+};
+} // namespace
+
 CommandDescription JsonReader::ParseCommandDescription(const json::Node &request)
 {
 
@@ -86,6 +211,24 @@ void JsonReader::ApplyCommands(tc::TransportCatalogue &catalogue) const
         }
     }
 
+    FinishTransportCatalogue(catalogue);
+}
+
+void JsonReader::AddBaseRequest(const json::Node &request, tc::TransportCatalogue &catalogue)
+{
+    ParseRequest(request);
+
+    if (commands_.back().command == "Stop"s)
+    {
+        catalogue.AddStop(MakeStop(commands_.back()));
+    }
+}
+
+/*
+ * Добавляет расстояния и маршруты: к этому моменту все остановки уже в справочнике
+ */
+void JsonReader::FinishTransportCatalogue(tc::TransportCatalogue &catalogue) const
+{
     for (const auto &c : commands_)
     {
         // command: автобус или остановка
@@ -107,6 +250,11 @@ void JsonReader::ApplyCommands(tc::TransportCatalogue &catalogue) const
     }
 }
 
+void JsonReader::SetDocument(json::Document document)
+{
+    document_ = std::move(document);
+}
+
 const json::Node &JsonReader::GetRenderSettings() const
 {
     return document_.GetRoot().AsDict().at("render_settings"s);
@@ -141,8 +289,118 @@ void JsonReader::FillTransportCatalogue(tc::TransportCatalogue &catalogue)
 
 tc::RoutingSettings JsonReader::FillRoutingSettings(const json::Node &settings) const
 {
-    return tc::RoutingSettings{settings.AsDict().at("bus_wait_time"s).AsInt(),
-                               settings.AsDict().at("bus_velocity"s).AsDouble()};
+    const json::Dict &request = settings.AsDict();
+    tc::RoutingSettings routing_settings;
+    routing_settings.bus_wait_time_ = request.at("bus_wait_time"s).AsInt();
+    routing_settings.bus_velocity_ = request.at("bus_velocity"s).AsDouble();
+
+    // При нулевой или отрицательной скорости веса рёбер бесконечны или отрицательны, и поиск пути теряет смысл
+    if (routing_settings.bus_velocity_ <= 0.0)
+    {
+        throw std::invalid_argument("bus_velocity must be positive"s);
+    }
+
+    routing_settings.build_threads_ = request.count("build_threads"s)
+                                          ? static_cast<size_t>(std::max(1, request.at("build_threads"s).AsInt()))
+                                          : parallel::DefaultThreadCount();
+
+    if (request.count("timetable_engine"s))
+    {
+        const std::string &engine = request.at("timetable_engine"s).AsString();
+
+        if (engine == "dijkstra"s)
+        {
+            routing_settings.timetable_engine_ = tc::TimetableEngine::DIJKSTRA;
+        }
+
+        else if (engine == "connection_scan"s)
+        {
+            routing_settings.timetable_engine_ = tc::TimetableEngine::CONNECTION_SCAN;
+        }
+
+        else
+        {
+            throw std::invalid_argument("unknown timetable_engine: "s + engine);
+        }
+    }
+
+    if (request.count("route_engine"s))
+    {
+        const std::string &engine = request.at("route_engine"s).AsString();
+
+        if (engine == "all_pairs"s)
+        {
+            routing_settings.route_engine_ = tc::RouteEngine::ALL_PAIRS;
+        }
+
+        else if (engine == "alt"s)
+        {
+            routing_settings.route_engine_ = tc::RouteEngine::ALT;
+        }
+
+        else if (engine == "crp"s)
+        {
+            routing_settings.route_engine_ = tc::RouteEngine::CRP;
+        }
+
+        else
+        {
+            throw std::invalid_argument("unknown route_engine: "s + engine);
+        }
+    }
+
+    if (request.count("landmark_count"s))
+    {
+        routing_settings.landmark_count_ = static_cast<size_t>(std::max(0, request.at("landmark_count"s).AsInt()));
+    }
+
+    if (request.count("cell_size"s))
+    {
+        routing_settings.cell_size_ = static_cast<size_t>(std::max(1, request.at("cell_size"s).AsInt()));
+    }
+
+    if (request.count("walk_speed"s))
+    {
+        routing_settings.walk_speed_ = request.at("walk_speed"s).AsDouble();
+
+        if (routing_settings.walk_speed_ <= 0.0)
+        {
+            throw std::invalid_argument("walk_speed must be positive"s);
+        }
+    }
+
+    if (request.count("walk_radius"s))
+    {
+        routing_settings.walk_radius_ = request.at("walk_radius"s).AsDouble();
+
+        // Ноль выключает пешие пересадки, отрицательный радиус дошёл бы до поиска в k-d дереве
+        if (routing_settings.walk_radius_ < 0.0)
+        {
+            throw std::invalid_argument("walk_radius must not be negative"s);
+        }
+    }
+
+    if (request.count("walk_stop_count"s))
+    {
+        routing_settings.walk_stop_count_ = static_cast<size_t>(std::max(1, request.at("walk_stop_count"s).AsInt()));
+    }
+
+    if (request.count("bus_schedules"s))
+    {
+        for (const auto &[bus, headways] : request.at("bus_schedules"s).AsDict())
+        {
+            auto &schedule = routing_settings.bus_schedules_[bus];
+
+            for (const auto &headway : headways.AsArray())
+            {
+                const json::Dict &description = headway.AsDict();
+                schedule.push_back({description.at("from"s).AsDouble(), description.at("to"s).AsDouble(),
+                                    description.at("headway"s).AsDouble()});
+            }
+        }
+    }
+
+    return routing_settings;
 }
 
 renderer::RenderSettings JsonReader::FillRenderSettings(const json::Node &settings) const
@@ -247,38 +505,172 @@ void JsonReader::ProcessColors(const json::Dict &request, renderer::RenderSettin
     }
 }
 
+std::optional<json::Node> JsonReader::ProcessRequest(const json::Dict &request, tc::TransportCatalogue &catalogue,
+                                                     RequestHandler &request_handler) const
+{
+    const auto &type = request.at("type").AsString();
+
+    if (type == "Stop")
+    {
+        return PrintStop(request, catalogue, request_handler);
+    }
+
+    if (type == "Bus")
+    {
+        return PrintBus(request, catalogue);
+    }
+
+    if (type == "Map")
+    {
+        return PrintMap(request, request_handler);
+    }
+
+    if (type == "Route")
+    {
+        return PrintRoute(request, catalogue, request_handler);
+    }
+
+    if (type == "RouteMatrix")
+    {
+        return PrintRouteMatrix(request, catalogue, request_handler);
+    }
+
+    if (type == "Reachable")
+    {
+        return PrintReachable(request, catalogue, request_handler);
+    }
+
+    if (type == "Nearest")
+    {
+        return PrintNearest(request, catalogue);
+    }
+
+    if (type == "StopsInRadius")
+    {
+        return PrintStopsInRadius(request, catalogue);
+    }
+
+    if (type == "StopSearch")
+    {
+        return PrintStopSearch(request, catalogue);
+    }
+
+    return std::nullopt;
+}
+
 void JsonReader::ProcessRequests(const json::Node &stat_requests, tc::TransportCatalogue &catalogue,
                                  RequestHandler &request_handler, std::ostream &output) const
 {
-    json::Array result;
+    const json::Array &requests = stat_requests.AsArray();
+
+    // Запросы пакета, у которых совпадают все поля, кроме id, выполняются один раз
+    // Пакет делится на отличающиеся запросы, только если он пойдёт в параллельную обработку
+    std::unordered_map<const json::Dict *, size_t, RequestHasher, RequestEqual> distinct_indices;
+    std::vector<const json::Dict *> distinct_requests;
+    std::vector<size_t> answer_indices;
+    distinct_requests.reserve(requests.size());
+    answer_indices.reserve(requests.size());
 
-    for (auto &request : stat_requests.AsArray())
+    const size_t thread_count = request_handler.GetRoutingSettings().build_threads_;
+    const bool deduplicate = thread_count > 1 && requests.size() >= PARALLEL_MIN_REQUEST_COUNT;
+
+    for (const auto &request : requests)
     {
-        const auto &request_map = request.AsDict();
-        const auto &type = request_map.at("type").AsString();
+        if (!deduplicate)
+        {
+            answer_indices.push_back(distinct_requests.size());
+            distinct_requests.push_back(&request.AsDict());
+            continue;
+        }
+
+        const auto [it, inserted] = distinct_indices.emplace(&request.AsDict(), distinct_requests.size());
+
+        if (inserted)
+        {
+            distinct_requests.push_back(&request.AsDict());
+        }
+
+        answer_indices.push_back(it->second);
+    }
 
-        if (type == "Stop")
+    // Ответ печатается один раз как элемент массива и хранится без значения request_id. Ответ, который так
+    // не делится, отмечается в unsplit и печатается заново для каждого запроса
+    std::vector<std::shared_ptr<const cache::PrintedAnswer>> answers(distinct_requests.size());
+    std::vector<char> unsplit(distinct_requests.size(), false);
+
+    auto process = [&](size_t index) {
+        const json::Dict &request = *distinct_requests[index];
+
+        // Маршрут между остановками берётся из кэша уже напечатанным
+        if (request.at("type"s).AsString() == "Route"s && IsStopRoute(request))
         {
-            result.push_back(PrintStop(request_map, catalogue, request_handler).AsDict());
+            answers[index] = GetRouteAnswer(catalogue.GetStop(request.at("from"s).AsString()),
+                                            catalogue.GetStop(request.at("to"s).AsString()), request_handler);
         }
 
-        if (type == "Bus")
+        if (answers[index])
         {
-            result.push_back(PrintBus(request_map, catalogue).AsDict());
+            return;
         }
 
-        if (type == "Map")
+        if (const auto answer = ProcessRequest(request, catalogue, request_handler))
         {
-            result.push_back(PrintMap(request_map, request_handler).AsDict());
+            if (auto printed = PrintAnswer(*answer))
+            {
+                answers[index] = std::make_shared<const cache::PrintedAnswer>(std::move(*printed));
+            }
+
+            else
+            {
+                unsplit[index] = true;
+            }
         }
+    };
+
+    if (thread_count > 1 && distinct_requests.size() >= PARALLEL_MIN_REQUEST_COUNT)
+    {
+        parallel::ParallelFor(distinct_requests.size(), thread_count, process);
+    }
 
-        if (type == "Route")
+    else
+    {
+        for (size_t index = 0; index < distinct_requests.size(); ++index)
         {
-            result.push_back(PrintRoute(request_map, catalogue, request_handler).AsDict());
+            process(index);
         }
     }
 
-    json::Print(json::Document{result}, output);
+    // Тот же вид, что у json::Print для массива ответов
+    bool first = true;
+    output << "[\n"sv;
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        const auto &answer = answers[answer_indices[i]];
+
+        if (unsplit[answer_indices[i]])
+        {
+            if (const auto uncached = ProcessRequest(requests[i].AsDict(), catalogue, request_handler))
+            {
+                output << (first ? ""sv : ",\n"sv) << "    "sv;
+                json::PrintNode(*uncached, output, 4);
+                first = false;
+            }
+
+            continue;
+        }
+
+        if (!answer)
+        {
+            continue;
+        }
+
+        output << (first ? ""sv : ",\n"sv) << "    "sv << answer->before_id << requests[i].AsDict().at("id"s).AsInt()
+               << answer->after_id;
+        first = false;
+    }
+
+    output << "\n]"sv;
 }
 
 const json::Node JsonReader::PrintBus(const json::Dict &request, tc::TransportCatalogue &catalogue_) const
@@ -335,11 +727,13 @@ const json::Node JsonReader::PrintStop(const json::Dict &request, tc::TransportC
 
     if (stop)
     {
+        const auto stop_buses = request_handler.GetBusesByStop(stop_name);
         json::Array buses;
+        buses.reserve(std::distance(stop_buses.begin(), stop_buses.end()));
 
-        for (const auto &bus : request_handler.GetBusesByStop(stop_name))
+        for (const names::Name bus : stop_buses)
         {
-            buses.push_back(bus);
+            buses.emplace_back(std::string(bus));
         }
 
         result = json::Builder{}.StartDict().Key("request_id").Value(id).Key("buses").Value(buses).EndDict().Build();
@@ -377,82 +771,592 @@ const json::Node JsonReader::PrintMap(const json::Dict &request, RequestHandler
 const json::Node JsonReader::PrintRoute(const json::Dict &request, tc::TransportCatalogue &catalogue_,
                                         RequestHandler &request_handler) const
 {
-    json::Node result;
+    if (request.count("from_point"s) || request.count("to_point"s))
+    {
+        return PrintPointRoute(request, catalogue_, request_handler);
+    }
 
     const int id = request.at("id"s).AsInt();
     const tc::Stop *from = catalogue_.GetStop(request.at("from"s).AsString());
     const tc::Stop *to = catalogue_.GetStop(request.at("to"s).AsString());
-    const auto &route = request_handler.GetRoute(from, to);
 
-    if (route)
+    if (request.count("max_transfers"s))
+    {
+        return PrintParetoRoute(request, from, to, request_handler);
+    }
+
+    if (request.count("alternatives"s))
+    {
+        return PrintAlternativeRoutes(request, from, to, request_handler);
+    }
+
+    if (request.count("depart_at"s))
+    {
+        return PrintTimedRoute(request, from, to, request_handler);
+    }
+
+    json::Node answer = MakeRouteAnswer(from, to, request_handler);
+
+    if (answer.IsDict())
+    {
+        json::Dict result = std::move(std::get<json::Dict>(answer.GetValue()));
+        result.emplace("request_id"s, id);
+
+        return json::Node{std::move(result)};
+    }
+
+    return json::Builder{}
+        .StartDict()
+        .Key("request_id"s)
+        .Value(id)
+        .Key("error_message"s)
+        .Value("not found"s)
+        .EndDict()
+        .Build();
+}
+
+const json::Node JsonReader::PrintPointRoute(const json::Dict &request, tc::TransportCatalogue &catalogue_,
+                                             RequestHandler &request_handler) const
+{
+    const int id = request.at("id"s).AsInt();
+    const json::Node not_found =
+        json::Builder{}.StartDict().Key("request_id"s).Value(id).Key("error_message"s).Value("not found"s).EndDict().Build();
+
+    // Конец маршрута: его координаты и остановки, между которыми и концом идут пешком.
+    // Остановка, заданная по названию, — единственная, и пешком до неё идти не нужно
+    auto parse_end = [&](const std::string &stop_key, const std::string &point_key,
+                         std::vector<std::pair<const tc::Stop *, double>> &stops) -> std::optional<geo::Coordinates> {
+        if (request.count(point_key))
+        {
+            const geo::Coordinates point = ParsePoint(request.at(point_key));
+            stops = request_handler.GetWalkingStops(point);
+
+            return point;
+        }
+
+        if (const tc::Stop *stop = catalogue_.GetStop(request.at(stop_key).AsString()))
+        {
+            stops.emplace_back(stop, 0.0);
+
+            return stop->coordinates;
+        }
+
+        return std::nullopt;
+    };
+
+    std::vector<std::pair<const tc::Stop *, double>> stops_from;
+    std::vector<std::pair<const tc::Stop *, double>> stops_to;
+    const auto point_from = parse_end("from"s, "from_point"s, stops_from);
+    const auto point_to = parse_end("to"s, "to_point"s, stops_to);
+
+    if (!point_from || !point_to)
+    {
+        return not_found;
+    }
+
+    const auto route = request_handler.GetRouteBetween(stops_from, stops_to);
+    const double walk_time = request_handler.GetWalkTime(geo::ComputeDistance(*point_from, *point_to));
+    json::Array items;
+
+    // Пешком всю дорогу, если так не дольше, чем с пересадкой на автобус
+    if (!route || walk_time <= route->weight)
+    {
+        items.push_back(MakeWalkItem(nullptr, nullptr, walk_time));
+
+        return json::Builder{}
+            .StartDict()
+            .Key("request_id"s)
+            .Value(id)
+            .Key("total_time"s)
+            .Value(walk_time)
+            .Key("items"s)
+            .Value(std::move(items))
+            .EndDict()
+            .Build();
+    }
+
+    const auto &[stop_from, walk_from] = stops_from[route->source];
+    const auto &[stop_to, walk_to] = stops_to[route->target];
+
+    if (request.count("from_point"s))
+    {
+        items.push_back(MakeWalkItem(nullptr, stop_from, walk_from));
+    }
+
+    for (auto &item : MakeRouteItems(route->edges, request_handler))
+    {
+        items.push_back(std::move(item));
+    }
+
+    if (request.count("to_point"s))
+    {
+        items.push_back(MakeWalkItem(stop_to, nullptr, walk_to));
+    }
+
+    return json::Builder{}
+        .StartDict()
+        .Key("request_id"s)
+        .Value(id)
+        .Key("total_time"s)
+        .Value(route->weight)
+        .Key("items"s)
+        .Value(std::move(items))
+        .EndDict()
+        .Build();
+}
+
+const json::Node JsonReader::PrintTimedRoute(const json::Dict &request, const tc::Stop *from, const tc::Stop *to,
+                                             RequestHandler &request_handler) const
+{
+    const int id = request.at("id"s).AsInt();
+    const double depart_at = request.at("depart_at"s).AsDouble();
+    const auto journey = from && to ? request_handler.GetJourney(from, to, depart_at) : std::nullopt;
+
+    if (!journey)
+    {
+        return json::Builder{}
+            .StartDict()
+            .Key("request_id"s)
+            .Value(id)
+            .Key("error_message"s)
+            .Value("not found"s)
+            .EndDict()
+            .Build();
+    }
+
+    return json::Builder{}
+        .StartDict()
+        .Key("request_id"s)
+        .Value(id)
+        .Key("arrival_time"s)
+        .Value(journey->arrival)
+        .Key("total_time"s)
+        .Value(journey->arrival - journey->departure)
+        .Key("items"s)
+        .Value(MakeJourneyItems(*journey))
+        .EndDict()
+        .Build();
+}
+
+const json::Node JsonReader::PrintParetoRoute(const json::Dict &request, const tc::Stop *from, const tc::Stop *to,
+                                              RequestHandler &request_handler) const
+{
+    const int id = request.at("id"s).AsInt();
+    const auto depart_at =
+        request.count("depart_at"s) ? std::optional<double>(request.at("depart_at"s).AsDouble()) : std::nullopt;
+    const size_t max_transfers = static_cast<size_t>(std::max(0, request.at("max_transfers"s).AsInt()));
+    const auto journeys = from && to ? request_handler.GetParetoJourneys(from, to, depart_at, max_transfers)
+                                     : std::vector<timetable::Journey>{};
+
+    if (journeys.empty())
     {
-        json::Array items;
-        double total_time = 0.0;
-        items.reserve(route.value().edges.size());
+        return json::Builder{}
+            .StartDict()
+            .Key("request_id"s)
+            .Value(id)
+            .Key("error_message"s)
+            .Value("not found"s)
+            .EndDict()
+            .Build();
+    }
+
+    json::Array routes;
+
+    for (const timetable::Journey &journey : journeys)
+    {
+        json::Dict route{{"transfers"s, static_cast<int>(std::max<size_t>(journey.legs.size(), 1) - 1)},
+                         {"total_time"s, journey.arrival - journey.departure},
+                         {"items"s, MakeJourneyItems(journey)}};
 
-        for (auto &id : route.value().edges)
+        if (depart_at)
         {
-            const graph::Edge<double> edge = request_handler.GetGraph().GetEdge(id);
+            route.emplace("arrival_time"s, journey.arrival);
+        }
+
+        routes.emplace_back(std::move(route));
+    }
+
+    return json::Builder{}.StartDict().Key("request_id"s).Value(id).Key("routes"s).Value(routes).EndDict().Build();
+}
+
+const json::Node JsonReader::PrintAlternativeRoutes(const json::Dict &request, const tc::Stop *from,
+                                                    const tc::Stop *to, RequestHandler &request_handler) const
+{
+    const int id = request.at("id"s).AsInt();
+    const size_t count = static_cast<size_t>(std::max(1, request.at("alternatives"s).AsInt()));
+    const double max_stretch =
+        request.count("max_stretch"s) ? request.at("max_stretch"s).AsDouble() : DEFAULT_MAX_STRETCH;
+    const auto alternatives = from && to ? request_handler.GetAlternativeRoutes(from, to, count, max_stretch)
+                                         : std::vector<graph::Router<double>::RouteInfo>{};
+
+    if (alternatives.empty())
+    {
+        return json::Builder{}
+            .StartDict()
+            .Key("request_id"s)
+            .Value(id)
+            .Key("error_message"s)
+            .Value("not found"s)
+            .EndDict()
+            .Build();
+    }
+
+    json::Array routes;
+
+    for (const auto &route : alternatives)
+    {
+        routes.push_back(MakeRouteBody(route.edges, request_handler));
+    }
+
+    return json::Builder{}.StartDict().Key("request_id"s).Value(id).Key("routes"s).Value(routes).EndDict().Build();
+}
+
+json::Array JsonReader::MakeJourneyItems(const timetable::Journey &journey) const
+{
+    json::Array items;
+    items.reserve(journey.legs.size() * 2);
+    double time = journey.departure;
+
+    for (const timetable::Leg &leg : journey.legs)
+    {
+        items.emplace_back(json::Builder{}
+                               .StartDict()
+                               .Key("type"s)
+                               .Value("Wait"s)
+                               .Key("stop_name"s)
+                               .Value(std::string(leg.from->name))
+                               .Key("time"s)
+                               .Value(leg.departure - time)
+                               .EndDict()
+                               .Build());
+
+        items.emplace_back(json::Builder{}
+                               .StartDict()
+                               .Key("type"s)
+                               .Value("Bus"s)
+                               .Key("bus"s)
+                               .Value(std::string(leg.bus->number))
+                               .Key("span_count"s)
+                               .Value(static_cast<int>(leg.span_count))
+                               .Key("time"s)
+                               .Value(leg.arrival - leg.departure)
+                               .EndDict()
+                               .Build());
+
+        time = leg.arrival;
+    }
 
-            if (edge.span_count == 0)
+    return items;
+}
+
+const json::Node JsonReader::PrintRouteMatrix(const json::Dict &request, tc::TransportCatalogue &catalogue_,
+                                              RequestHandler &request_handler) const
+{
+    const int id = request.at("id"s).AsInt();
+    const bool with_items = request.count("with_items"s) && request.at("with_items"s).AsBool();
+    auto find_stops = [&request, &catalogue_](const std::string &key) {
+        std::vector<const tc::Stop *> stops;
+
+        for (const auto &name : request.at(key).AsArray())
+        {
+            stops.push_back(catalogue_.GetStop(name.AsString()));
+        }
+
+        return stops;
+    };
+
+    const std::vector<const tc::Stop *> sources = find_stops("sources"s);
+    const std::vector<const tc::Stop *> targets = find_stops("targets"s);
+
+    if (std::count(sources.begin(), sources.end(), nullptr) || std::count(targets.begin(), targets.end(), nullptr))
+    {
+        return json::Builder{}
+            .StartDict()
+            .Key("request_id"s)
+            .Value(id)
+            .Key("error_message"s)
+            .Value("not found"s)
+            .EndDict()
+            .Build();
+    }
+
+    // Строка матрицы на источник: один проход по строке таблицы маршрутов, источники обрабатываются параллельно
+    json::Array total_times(sources.size());
+    json::Array items(with_items ? sources.size() : 0);
+
+    parallel::ParallelFor(
+        sources.size(), request_handler.GetRoutingSettings().build_threads_,
+        [&](size_t source) {
+            json::Array times_row;
+            times_row.reserve(targets.size());
+
+            for (const auto &time : request_handler.GetRouteTimes(sources[source], targets))
             {
-                items.emplace_back(json::Node(json::Builder{}
-                                                  .StartDict()
-                                                  .Key("type"s)
-                                                  .Value("Wait"s)
-                                                  .Key("stop_name"s)
-                                                  .Value(edge.name)
-                                                  .Key("time"s)
-                                                  .Value(edge.weight)
-                                                  .EndDict()
-                                                  .Build()));
-
-                total_time += edge.weight;
+                times_row.push_back(time ? json::Node(*time) : json::Node{});
             }
 
-            else
+            total_times[source] = std::move(times_row);
+
+            if (with_items)
             {
-                items.emplace_back(json::Node(json::Builder{}
-                                                  .StartDict()
-                                                  .Key("type"s)
-                                                  .Value("Bus"s)
-                                                  .Key("bus"s)
-                                                  .Value(edge.name)
-                                                  .Key("span_count"s)
-                                                  .Value(static_cast<int>(edge.span_count))
-                                                  .Key("time"s)
-                                                  .Value(edge.weight)
-                                                  .EndDict()
-                                                  .Build()));
-
-                total_time += edge.weight;
+                json::Array items_row;
+                items_row.reserve(targets.size());
+
+                for (const tc::Stop *target : targets)
+                {
+                    json::Node answer = MakeRouteAnswer(sources[source], target, request_handler);
+                    items_row.push_back(answer.IsDict() ? std::move(std::get<json::Dict>(answer.GetValue()).at("items"s))
+                                                        : json::Node{});
+                }
+
+                items[source] = std::move(items_row);
             }
+        },
+        1);
+
+    json::Dict result{{"request_id"s, id}, {"total_times"s, std::move(total_times)}};
+
+    if (with_items)
+    {
+        result.emplace("items"s, std::move(items));
+    }
+
+    return json::Node{std::move(result)};
+}
+
+const json::Node JsonReader::PrintReachable(const json::Dict &request, tc::TransportCatalogue &catalogue_,
+                                            RequestHandler &request_handler) const
+{
+    const int id = request.at("id"s).AsInt();
+    const tc::Stop *from = catalogue_.GetStop(request.at("from"s).AsString());
+
+    if (!from)
+    {
+        return json::Builder{}
+            .StartDict()
+            .Key("request_id"s)
+            .Value(id)
+            .Key("error_message"s)
+            .Value("not found"s)
+            .EndDict()
+            .Build();
+    }
+
+    auto reached = request_handler.GetReachableStops(from, request.at("max_time"s).AsDouble());
+
+    std::sort(reached.begin(), reached.end(), [](const auto &lhs, const auto &rhs) {
+        return std::tie(lhs.second, lhs.first->name) < std::tie(rhs.second, rhs.first->name);
+    });
+
+    json::Array stops;
+    stops.reserve(reached.size());
+
+    for (const auto &[stop, time] : reached)
+    {
+        stops.emplace_back(
+            json::Builder{}.StartDict().Key("stop_name"s).Value(std::string(stop->name)).Key("time"s).Value(time).EndDict().Build());
+    }
+
+    return json::Builder{}.StartDict().Key("request_id"s).Value(id).Key("stops"s).Value(stops).EndDict().Build();
+}
+
+const json::Node JsonReader::PrintNearest(const json::Dict &request, tc::TransportCatalogue &catalogue_) const
+{
+    const geo::Coordinates point{request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble()};
+    const size_t count = request.count("count"s) ? static_cast<size_t>(std::max(0, request.at("count"s).AsInt())) : 1;
+
+    return MakeStopDistances(request.at("id"s).AsInt(), catalogue_.GetStopIndex().FindNearest(point, count));
+}
+
+const json::Node JsonReader::PrintStopsInRadius(const json::Dict &request, tc::TransportCatalogue &catalogue_) const
+{
+    const geo::Coordinates point{request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble()};
+
+    return MakeStopDistances(request.at("id"s).AsInt(),
+                             catalogue_.GetStopIndex().FindInRadius(point, request.at("radius"s).AsDouble()));
+}
+
+json::Node JsonReader::MakeStopDistances(int id, const spatial::StopIndex::StopDistances &stops) const
+{
+    json::Array items;
+    items.reserve(stops.size());
+
+    for (const auto &[stop, distance] : stops)
+    {
+        items.emplace_back(json::Builder{}
+                               .StartDict()
+                               .Key("stop_name"s)
+                               .Value(std::string(stop->name))
+                               .Key("distance"s)
+                               .Value(distance)
+                               .EndDict()
+                               .Build());
+    }
+
+    return json::Builder{}.StartDict().Key("request_id"s).Value(id).Key("stops"s).Value(items).EndDict().Build();
+}
+
+const json::Node JsonReader::PrintStopSearch(const json::Dict &request, tc::TransportCatalogue &catalogue_) const
+{
+    auto get_count = [&request](const std::string &key, int default_value) {
+        return static_cast<size_t>(std::max(0, request.count(key) ? request.at(key).AsInt() : default_value));
+    };
+
+    const auto page = catalogue_.GetStopNameIndex().Find(request.at("query"s).AsString(), get_count("max_edits"s, 1),
+                                                         get_count("offset"s, 0), get_count("limit"s, 10));
+    json::Array stops;
+    stops.reserve(page.stops.size());
+
+    for (const tc::Stop *stop : page.stops)
+    {
+        stops.emplace_back(std::string(stop->name));
+    }
+
+    return json::Builder{}
+        .StartDict()
+        .Key("request_id"s)
+        .Value(request.at("id"s).AsInt())
+        .Key("stops"s)
+        .Value(std::move(stops))
+        .Key("total"s)
+        .Value(static_cast<int>(page.total))
+        .EndDict()
+        .Build();
+}
+
+std::shared_ptr<const cache::PrintedAnswer> JsonReader::GetRouteAnswer(const tc::Stop *from, const tc::Stop *to,
+                                                                       RequestHandler &request_handler) const
+{
+    std::shared_ptr<const cache::PrintedAnswer> answer = request_handler.FindCachedRoute(from, to);
+
+    if (!answer)
+    {
+        json::Node body = MakeRouteAnswer(from, to, request_handler);
+        json::Dict result = body.IsDict() ? std::move(std::get<json::Dict>(body.GetValue()))
+                                          : json::Dict{{"error_message"s, "not found"s}};
+        result.emplace("request_id"s, 0);
+        auto printed = PrintAnswer(json::Node{std::move(result)});
+
+        if (!printed)
+        {
+            return nullptr;
         }
 
-        result = json::Builder{}
-                     .StartDict()
-                     .Key("request_id"s)
-                     .Value(id)
-                     .Key("total_time"s)
-                     .Value(total_time)
-                     .Key("items"s)
-                     .Value(items)
-                     .EndDict()
-                     .Build();
+        answer = std::make_shared<const cache::PrintedAnswer>(std::move(*printed));
+        request_handler.CacheRoute(from, to, answer);
     }
 
-    else
+    return answer;
+}
+
+bool JsonReader::IsStopRoute(const json::Dict &request)
+{
+    return !request.count("from_point"s) && !request.count("to_point"s) && !request.count("max_transfers"s) &&
+           !request.count("alternatives"s) && !request.count("depart_at"s);
+}
+
+json::Node JsonReader::MakeRouteAnswer(const tc::Stop *from, const tc::Stop *to,
+                                       RequestHandler &request_handler) const
+{
+    const auto &route = request_handler.GetRoute(from, to);
+
+    if (!route)
     {
-        result = json::Builder{}
-                     .StartDict()
-                     .Key("request_id"s)
-                     .Value(id)
-                     .Key("error_message"s)
-                     .Value("not found"s)
-                     .EndDict()
-                     .Build();
+        return json::Node{};
     }
 
-    return result;
+    return MakeRouteBody(route.value().edges, request_handler);
+}
+
+json::Node JsonReader::MakeRouteBody(const std::vector<graph::EdgeId> &edges, RequestHandler &request_handler) const
+{
+    double total_time = 0.0;
+
+    for (const auto id : edges)
+    {
+        total_time += request_handler.GetGraph().GetEdge(id).weight;
+    }
+
+    return json::Builder{}
+        .StartDict()
+        .Key("total_time"s)
+        .Value(total_time)
+        .Key("items"s)
+        .Value(MakeRouteItems(edges, request_handler))
+        .EndDict()
+        .Build();
+}
+
+json::Array JsonReader::MakeRouteItems(const std::vector<graph::EdgeId> &edges, RequestHandler &request_handler) const
+{
+    json::Array items;
+    items.reserve(edges.size());
+
+    for (auto &id : edges)
+    {
+        const graph::Edge<double> edge = request_handler.GetGraph().GetEdge(id);
+
+        if (tc::TransportRouter::IsWalkEdge(edge))
+        {
+            items.push_back(MakeWalkItem(request_handler.GetVertexStop(edge.from),
+                                         request_handler.GetVertexStop(edge.to), edge.weight));
+        }
+
+        else if (edge.span_count == 0)
+        {
+            items.emplace_back(json::Node(json::Builder{}
+                                              .StartDict()
+                                              .Key("type"s)
+                                              .Value("Wait"s)
+                                              .Key("stop_name"s)
+                                              .Value(std::string(edge.name))
+                                              .Key("time"s)
+                                              .Value(edge.weight)
+                                              .EndDict()
+                                              .Build()));
+        }
+
+        else
+        {
+            items.emplace_back(json::Node(json::Builder{}
+                                              .StartDict()
+                                              .Key("type"s)
+                                              .Value("Bus"s)
+                                              .Key("bus"s)
+                                              .Value(std::string(edge.name))
+                                              .Key("span_count"s)
+                                              .Value(static_cast<int>(edge.span_count))
+                                              .Key("time"s)
+                                              .Value(edge.weight)
+                                              .EndDict()
+                                              .Build()));
+        }
+    }
+
+    return items;
+}
+
+json::Node JsonReader::MakeWalkItem(const tc::Stop *from, const tc::Stop *to, double time) const
+{
+    json::Dict item{{"type"s, json::Node{"Walk"s}}, {"time"s, json::Node{time}}};
+
+    if (from)
+    {
+        item.emplace("from"s, std::string(from->name));
+    }
+
+    if (to)
+    {
+        item.emplace("to"s, std::string(to->name));
+    }
+
+    return json::Node{std::move(item)};
+}
+
+geo::Coordinates JsonReader::ParsePoint(const json::Node &point)
+{
+    const json::Dict &description = point.AsDict();
+
+    return {description.at("latitude"s).AsDouble(), description.at("longitude"s).AsDouble()};
 }
 } // end namespace json_reader
\ No newline at end of file
@@ -10,16 +10,103 @@ void RunServer(httplib::Server &svr, const std::string &host, int port)
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     httplib::Server svr;
     ServerState state;
 
+    std::string image_path;
+    std::string data_dir;
+    wal::LogSettings log_settings;
+    std::chrono::seconds compaction_interval{60};
+
+    // --image <path>: обслуживание только для чтения из отображённого в память образа справочника
+    // --data-dir <dir>: снимок и журнал изменений, восстанавливаемые при запуске
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--image" && has_value)
+        {
+            image_path = argv[++i];
+        }
+
+        else if (arg == "--data-dir" && has_value)
+        {
+            data_dir = argv[++i];
+        }
+
+        else if (arg == "--wal-commit-interval-ms" && has_value)
+        {
+            log_settings.commit_interval = std::chrono::milliseconds(std::stoi(argv[++i]));
+        }
+
+        else if (arg == "--wal-batch" && has_value)
+        {
+            log_settings.max_batch = static_cast<size_t>(std::stoi(argv[++i]));
+        }
+
+        else if (arg == "--wal-no-fsync")
+        {
+            log_settings.fsync = false;
+        }
+
+        else if (arg == "--compaction-interval-s" && has_value)
+        {
+            compaction_interval = std::chrono::seconds(std::stoi(argv[++i]));
+        }
+
+        else if (arg == "--route-cache-size" && has_value)
+        {
+            state.route_cache = std::make_unique<cache::RouteCache>(static_cast<size_t>(std::stoul(argv[++i])));
+        }
+    }
+
+    try
+    {
+        if (!data_dir.empty())
+        {
+            HandleRestore(data_dir, log_settings, state);
+        }
+
+        if (!image_path.empty())
+        {
+            HandleOpenImage(image_path, state);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Failed to restore catalogue: " << e.what() << "\n";
+        std::exit(1);
+    }
+
+    if (!data_dir.empty())
+    {
+        // Фоновая свёртка журнала изменений в новый снимок
+        std::thread([&state, compaction_interval] {
+            while (true)
+            {
+                std::this_thread::sleep_for(compaction_interval);
+
+                try
+                {
+                    HandleCompaction(state);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "Compaction failed: " << e.what() << "\n";
+                }
+            }
+        }).detach();
+    }
+
     RegisterLoadEndpoints(svr, state);
     RegisterQueryEndpoints(svr, state);
     RegisterMapEndpoints(svr, state);
     RegisterPutEndpoints(svr, state);
     RegisterPatchEndpoints(svr, state);
+    RegisterImageEndpoints(svr, state);
 
     RunServer(svr, "0.0.0.0", 8080);
 }
\ No newline at end of file
@@ -0,0 +1,845 @@
+#include "../include/mutation_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wal
+{
+namespace
+{
+constexpr char MAGIC[8] = {'T', 'C', 'W', 'A', 'L', '\0', '\0', '\1'};
+constexpr size_t LOG_HEADER_SIZE = sizeof(MAGIC) + sizeof(uint64_t); // MAGIC и поколение журнала
+constexpr size_t RECORD_HEADER_SIZE = sizeof(uint32_t) * 2;
+
+enum class RecordKind : uint8_t
+{
+    PUT = 1,
+    PATCH = 2,
+};
+
+enum class EntityType : uint8_t
+{
+    STOP = 1,
+    BUS = 2,
+};
+
+uint32_t Crc32(std::string_view data)
+{
+    static const auto table = [] {
+        std::array<uint32_t, 256> result{};
+
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+
+            result[i] = crc;
+        }
+
+        return result;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (const char c : data)
+    {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFFu;
+}
+
+std::runtime_error SystemError(const std::string &what, const std::string &path)
+{
+    return std::runtime_error(what + " '"s + path + "': "s + std::strerror(errno));
+}
+
+class RecordWriter
+{
+  public:
+    template <typename T> void Put(T value)
+    {
+        data_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void PutString(std::string_view str)
+    {
+        Put(static_cast<uint32_t>(str.size()));
+        data_.append(str);
+    }
+
+    std::string Release()
+    {
+        return std::move(data_);
+    }
+
+  private:
+    std::string data_;
+};
+
+class RecordReader
+{
+  public:
+    explicit RecordReader(std::string_view data) : data_(data)
+    {
+    }
+
+    template <typename T> T Get()
+    {
+        T value;
+        std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+
+        return value;
+    }
+
+    std::string_view GetString()
+    {
+        return Take(Get<uint32_t>());
+    }
+
+  private:
+    std::string_view Take(size_t size)
+    {
+        if (size > data_.size())
+        {
+            throw std::runtime_error("truncated log record"s);
+        }
+
+        std::string_view result = data_.substr(0, size);
+        data_.remove_prefix(size);
+
+        return result;
+    }
+
+    std::string_view data_;
+};
+
+void WriteAll(int fd, std::string_view data, const std::string &path)
+{
+    while (!data.empty())
+    {
+        const ssize_t n = ::write(fd, data.data(), data.size());
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (n < 0)
+        {
+            throw SystemError("failed to write log"s, path);
+        }
+
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+}
+
+// Запись журнала на диске: [размер][crc32][данные]
+std::string FrameRecord(std::string_view record)
+{
+    RecordWriter writer;
+    writer.Put(static_cast<uint32_t>(record.size()));
+    writer.Put(Crc32(record));
+    std::string result = writer.Release();
+    result += record;
+
+    return result;
+}
+
+void SyncDirectory(const std::string &path)
+{
+    const auto slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "."s : path.substr(0, slash + 1);
+
+    if (const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY); dir_fd >= 0)
+    {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+void WriteHeader(int fd, uint64_t generation, const std::string &path)
+{
+    std::string header(MAGIC, sizeof(MAGIC));
+    header.append(reinterpret_cast<const char *>(&generation), sizeof(generation));
+
+    if (::ftruncate(fd, 0) != 0 || ::lseek(fd, 0, SEEK_SET) < 0)
+    {
+        throw SystemError("failed to truncate log"s, path);
+    }
+
+    WriteAll(fd, header, path);
+
+    if (::fsync(fd) != 0)
+    {
+        throw SystemError("failed to sync log"s, path);
+    }
+}
+
+struct LogContent
+{
+    uint64_t generation = 0;
+    std::vector<std::string> records;
+    uint64_t valid_size = 0; // Длина корректной части файла
+};
+
+LogContent ReadRecords(int fd, const std::string &path)
+{
+    struct stat st;
+
+    if (::fstat(fd, &st) != 0)
+    {
+        throw SystemError("failed to stat log"s, path);
+    }
+
+    std::string content(static_cast<size_t>(st.st_size), '\0');
+
+    for (size_t read = 0; read < content.size();)
+    {
+        const ssize_t n = ::pread(fd, content.data() + read, content.size() - read, static_cast<off_t>(read));
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            throw SystemError("failed to read log"s, path);
+        }
+
+        read += static_cast<size_t>(n);
+    }
+
+    if (content.size() < LOG_HEADER_SIZE || std::memcmp(content.data(), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        if (!content.empty())
+        {
+            throw std::runtime_error("log '"s + path + "' has unsupported format"s);
+        }
+
+        return {};
+    }
+
+    LogContent result;
+    std::memcpy(&result.generation, content.data() + sizeof(MAGIC), sizeof(result.generation));
+    size_t offset = LOG_HEADER_SIZE;
+
+    while (content.size() - offset >= RECORD_HEADER_SIZE)
+    {
+        uint32_t size = 0;
+        uint32_t crc = 0;
+        std::memcpy(&size, content.data() + offset, sizeof(size));
+        std::memcpy(&crc, content.data() + offset + sizeof(size), sizeof(crc));
+
+        if (content.size() - offset - RECORD_HEADER_SIZE < size)
+        {
+            break;
+        }
+
+        std::string_view payload(content.data() + offset + RECORD_HEADER_SIZE, size);
+
+        if (Crc32(payload) != crc)
+        {
+            break;
+        }
+
+        result.records.emplace_back(payload);
+        offset += RECORD_HEADER_SIZE + size;
+    }
+
+    result.valid_size = offset;
+
+    return result;
+}
+} // namespace
+
+MutationLog::MutationLog(std::string path, LogSettings settings) : path_(std::move(path)), settings_(settings)
+{
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+
+    if (fd_ < 0)
+    {
+        throw SystemError("failed to open log"s, path_);
+    }
+
+    try
+    {
+        LogContent content = ReadRecords(fd_, path_);
+        recovered_ = std::move(content.records);
+        generation_ = content.generation;
+        appended_seq_ = durable_seq_ = recovered_.size();
+
+        if (content.valid_size == 0)
+        {
+            WriteHeader(fd_, generation_, path_);
+            content.valid_size = LOG_HEADER_SIZE;
+        }
+
+        // Отбрасываем недописанный при сбое хвост
+        if (::ftruncate(fd_, static_cast<off_t>(content.valid_size)) != 0 ||
+            ::lseek(fd_, static_cast<off_t>(content.valid_size), SEEK_SET) < 0)
+        {
+            throw SystemError("failed to truncate log"s, path_);
+        }
+
+        size_ = content.valid_size - LOG_HEADER_SIZE;
+    }
+    catch (...)
+    {
+        ::close(fd_);
+        throw;
+    }
+
+    flusher_ = std::thread([this] { FlushLoop(); });
+}
+
+MutationLog::~MutationLog()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+
+    pending_cv_.notify_all();
+    flusher_.join();
+    ::close(fd_);
+}
+
+std::vector<std::string> MutationLog::TakeRecoveredRecords()
+{
+    return std::move(recovered_);
+}
+
+uint64_t MutationLog::Append(std::string record)
+{
+    const std::string framed = FrameRecord(record);
+
+    std::lock_guard lock(mutex_);
+    pending_ += framed;
+    ++pending_count_;
+
+    if (pending_count_ == 1 || pending_count_ >= settings_.max_batch)
+    {
+        pending_cv_.notify_one();
+    }
+
+    return ++appended_seq_;
+}
+
+void MutationLog::WaitDurable(uint64_t seq)
+{
+    std::unique_lock lock(mutex_);
+    durable_cv_.wait(lock, [this, seq] { return durable_seq_ >= seq || failed_seq_ >= seq; });
+
+    if (durable_seq_ < seq)
+    {
+        throw std::runtime_error(error_);
+    }
+}
+
+void MutationLog::CheckWritable() const
+{
+    std::lock_guard lock(mutex_);
+
+    if (failed_seq_ > durable_seq_)
+    {
+        throw std::runtime_error("log '"s + path_ + "' accepts no changes until the next snapshot: "s + error_);
+    }
+}
+
+bool MutationLog::IsFailed() const
+{
+    std::lock_guard lock(mutex_);
+
+    return failed_seq_ > durable_seq_;
+}
+
+void MutationLog::Reset(uint64_t generation)
+{
+    std::lock_guard io_lock(io_mutex_);
+    std::lock_guard lock(mutex_);
+
+    WriteHeader(fd_, generation, path_);
+    generation_ = generation;
+    generation_seq_ = appended_seq_;
+    pending_.clear();
+    pending_count_ = 0;
+    size_ = 0;
+    durable_seq_ = appended_seq_;
+    failed_seq_ = 0;
+    error_.clear();
+    durable_cv_.notify_all();
+}
+
+uint64_t MutationLog::GetLastSeq() const
+{
+    std::lock_guard lock(mutex_);
+
+    return appended_seq_;
+}
+
+LogPosition MutationLog::GetPosition(uint64_t seq) const
+{
+    std::lock_guard lock(mutex_);
+
+    if (seq < generation_seq_ || seq > appended_seq_)
+    {
+        throw std::logic_error("record is out of the current generation of log '"s + path_ + "'"s);
+    }
+
+    return {generation_, seq, seq - generation_seq_};
+}
+
+void MutationLog::Rotate(const LogPosition &position)
+{
+    std::lock_guard io_lock(io_mutex_);
+    std::lock_guard lock(mutex_);
+
+    if (position.generation != generation_ || position.seq < generation_seq_ || position.seq > appended_seq_)
+    {
+        throw std::logic_error("position does not belong to the current generation of log '"s + path_ + "'"s);
+    }
+
+    // Файл хранит записи поколения подряд с первой, поэтому вошедшие в снимок — это его начало
+    const LogContent content = ReadRecords(fd_, path_);
+    std::string tail;
+
+    for (size_t i = position.seq - generation_seq_; i < content.records.size(); ++i)
+    {
+        tail += FrameRecord(content.records[i]);
+    }
+
+    const std::string tmp_path = path_ + ".tmp"s;
+    const int fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        throw SystemError("failed to open log"s, tmp_path);
+    }
+
+    try
+    {
+        WriteHeader(fd, generation_ + 1, tmp_path);
+        WriteAll(fd, tail, tmp_path);
+
+        if (::fsync(fd) != 0)
+        {
+            throw SystemError("failed to sync log"s, tmp_path);
+        }
+
+        if (::rename(tmp_path.c_str(), path_.c_str()) != 0)
+        {
+            throw SystemError("failed to replace log"s, path_);
+        }
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+
+    SyncDirectory(path_);
+    ::close(fd_);
+    fd_ = fd;
+
+    // Записи очереди до позиции уже в снимке: в новое поколение они попасть не должны
+    size_t offset = 0;
+
+    for (uint64_t seq = std::max(durable_seq_, failed_seq_); seq < position.seq && offset < pending_.size(); ++seq)
+    {
+        uint32_t size = 0;
+        std::memcpy(&size, pending_.data() + offset, sizeof(size));
+        offset += RECORD_HEADER_SIZE + size;
+        --pending_count_;
+    }
+
+    pending_.erase(0, offset);
+    generation_ += 1;
+    generation_seq_ = position.seq;
+    size_ = tail.size();
+    durable_seq_ = std::max(durable_seq_, position.seq);
+
+    if (failed_seq_ <= durable_seq_)
+    {
+        failed_seq_ = 0;
+        error_.clear();
+    }
+
+    durable_cv_.notify_all();
+}
+
+uint64_t MutationLog::GetGeneration() const
+{
+    std::lock_guard lock(mutex_);
+
+    return generation_;
+}
+
+uint64_t MutationLog::GetSize() const
+{
+    std::lock_guard lock(mutex_);
+
+    return size_ + pending_.size();
+}
+
+void MutationLog::FlushLoop()
+{
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex_);
+            pending_cv_.wait(lock, [this] { return stop_ || pending_count_ > 0; });
+
+            if (stop_ && pending_count_ == 0)
+            {
+                return;
+            }
+
+            // Групповая фиксация: даём другим запросам присоединиться к этому fsync
+            pending_cv_.wait_for(lock, settings_.commit_interval,
+                                 [this] { return stop_ || pending_count_ >= settings_.max_batch; });
+        }
+
+        std::lock_guard io_lock(io_mutex_);
+        std::string batch;
+        uint64_t batch_seq = 0;
+        bool is_failed = false;
+
+        {
+            std::lock_guard lock(mutex_);
+            batch.swap(pending_);
+            pending_count_ = 0;
+            batch_seq = appended_seq_;
+            is_failed = failed_seq_ > durable_seq_;
+        }
+
+        // После потерянной группы запись следующих оставила бы в журнале изменения без их предшественников
+        if (is_failed)
+        {
+            std::lock_guard lock(mutex_);
+            failed_seq_ = batch_seq;
+        }
+
+        else
+        {
+            try
+            {
+                WriteAll(fd_, batch, path_);
+
+                if (settings_.fsync && ::fdatasync(fd_) != 0)
+                {
+                    throw SystemError("failed to sync log"s, path_);
+                }
+
+                std::lock_guard lock(mutex_);
+                size_ += batch.size();
+                durable_seq_ = std::max(durable_seq_, batch_seq);
+            }
+            catch (const std::exception &e)
+            {
+                // Недописанная группа срезается, чтобы восстановление не споткнулось о её обрывок
+                const off_t valid_size = static_cast<off_t>(LOG_HEADER_SIZE + size_);
+                const bool is_truncated = ::ftruncate(fd_, valid_size) == 0 && ::lseek(fd_, valid_size, SEEK_SET) >= 0;
+
+                std::lock_guard lock(mutex_);
+                error_ = is_truncated ? e.what() : e.what() + "; failed to truncate log"s;
+                failed_seq_ = batch_seq;
+            }
+        }
+
+        durable_cv_.notify_all();
+    }
+}
+
+std::string EncodePut(const json::Array &base_requests)
+{
+    RecordWriter writer;
+    writer.Put(RecordKind::PUT);
+    writer.Put(static_cast<uint32_t>(base_requests.size()));
+
+    for (const auto &request_node : base_requests)
+    {
+        const auto &request = request_node.AsDict();
+        const auto &type = request.at("type"s).AsString();
+
+        if (type == "Stop"s)
+        {
+            writer.Put(EntityType::STOP);
+            writer.PutString(request.at("name"s).AsString());
+            writer.Put(request.at("latitude"s).AsDouble());
+            writer.Put(request.at("longitude"s).AsDouble());
+
+            if (request.count("road_distances"s))
+            {
+                const auto &road_distances = request.at("road_distances"s).AsDict();
+                writer.Put(static_cast<uint32_t>(road_distances.size()));
+
+                for (const auto &[stop_name, distance] : road_distances)
+                {
+                    writer.PutString(stop_name);
+                    writer.Put(static_cast<int32_t>(distance.AsInt()));
+                }
+            }
+
+            else
+            {
+                writer.Put(uint32_t{0});
+            }
+        }
+
+        else if (type == "Bus"s)
+        {
+            const auto &stops = request.at("stops"s).AsArray();
+            writer.Put(EntityType::BUS);
+            writer.PutString(request.at("name"s).AsString());
+            writer.Put(static_cast<uint8_t>(request.at("is_roundtrip"s).AsBool()));
+            writer.Put(static_cast<uint32_t>(stops.size()));
+
+            for (const auto &stop : stops)
+            {
+                writer.PutString(stop.AsString());
+            }
+        }
+
+        else
+        {
+            throw std::invalid_argument("unknown request type '"s + type + "'"s);
+        }
+    }
+
+    return writer.Release();
+}
+
+std::string EncodePatch(const json::Array &base_requests)
+{
+    RecordWriter writer;
+    writer.Put(RecordKind::PATCH);
+
+    uint32_t count = 0;
+
+    for (const auto &request_node : base_requests)
+    {
+        count += request_node.AsDict().at("type"s).AsString() == "Bus"s;
+    }
+
+    writer.Put(count);
+
+    for (const auto &request_node : base_requests)
+    {
+        const auto &request = request_node.AsDict();
+
+        if (request.at("type"s).AsString() != "Bus"s)
+        {
+            continue;
+        }
+
+        writer.PutString(request.at("name"s).AsString());
+        writer.Put(static_cast<uint8_t>(request.count("stops"s) != 0));
+
+        if (request.count("stops"s))
+        {
+            const auto &stops = request.at("stops"s).AsArray();
+            writer.Put(static_cast<uint32_t>(request.count("position"s) ? request.at("position"s).AsInt() : 0));
+            writer.Put(static_cast<uint32_t>(stops.size()));
+
+            for (const auto &stop : stops)
+            {
+                writer.PutString(stop.AsString());
+            }
+        }
+
+        writer.Put(static_cast<uint8_t>(request.count("is_roundtrip"s) != 0));
+
+        if (request.count("is_roundtrip"s))
+        {
+            writer.Put(static_cast<uint8_t>(request.at("is_roundtrip"s).AsBool()));
+        }
+    }
+
+    return writer.Release();
+}
+
+namespace
+{
+// Запись PUT /stop или PUT /bus; строки указывают в данные записи
+struct PutRecord
+{
+    std::vector<tc::Stop> stops;
+    std::vector<std::vector<std::pair<std::string_view, int>>> distances;
+    std::vector<tc::Bus> buses;
+    std::vector<std::vector<std::string_view>> bus_stops;
+};
+
+PutRecord ReadPut(RecordReader &reader, uint32_t count)
+{
+    PutRecord result;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (reader.Get<EntityType>() == EntityType::STOP)
+        {
+            tc::Stop &stop = result.stops.emplace_back();
+            stop.name = reader.GetString();
+            stop.coordinates.lat = reader.Get<double>();
+            stop.coordinates.lng = reader.Get<double>();
+            auto &stop_distances = result.distances.emplace_back();
+
+            for (uint32_t j = reader.Get<uint32_t>(); j > 0; --j)
+            {
+                const auto to = reader.GetString();
+                stop_distances.emplace_back(to, reader.Get<int32_t>());
+            }
+        }
+
+        else
+        {
+            tc::Bus &bus = result.buses.emplace_back();
+            bus.number = reader.GetString();
+            bus.is_roundtrip = reader.Get<uint8_t>() != 0;
+            auto &stops_of_bus = result.bus_stops.emplace_back();
+
+            for (uint32_t j = reader.Get<uint32_t>(); j > 0; --j)
+            {
+                stops_of_bus.push_back(reader.GetString());
+            }
+        }
+    }
+
+    return result;
+}
+
+// Маршрут с неизвестной остановкой отклоняется до изменения справочника, а не применяется наполовину
+void CheckBusStops(const PutRecord &put, const tc::TransportCatalogue &catalogue)
+{
+    for (const auto &stops_of_bus : put.bus_stops)
+    {
+        for (const auto stop_name : stops_of_bus)
+        {
+            const bool is_new_stop = std::any_of(put.stops.begin(), put.stops.end(), [stop_name](const tc::Stop &stop) {
+                return std::string_view(stop.name) == stop_name;
+            });
+
+            if (!is_new_stop && !catalogue.GetStop(stop_name))
+            {
+                throw std::invalid_argument("unknown stop '"s + std::string(stop_name) + "'"s);
+            }
+        }
+    }
+}
+} // namespace
+
+void CheckRecord(std::string_view record, const tc::TransportCatalogue &catalogue)
+{
+    RecordReader reader(record);
+    const auto kind = reader.Get<RecordKind>();
+    const auto count = reader.Get<uint32_t>();
+
+    // Остановки не удаляются, поэтому запись, прошедшая проверку, применится и позже, и при восстановлении
+    if (kind == RecordKind::PUT)
+    {
+        CheckBusStops(ReadPut(reader, count), catalogue);
+    }
+}
+
+/*
+ * Обработчики PUT /stop, PUT /bus и PATCH /patch применяют изменения этой же функцией, поэтому справочник,
+ * восстановленный из журнала, совпадает с живым. Порядок тот же, что при загрузке: сначала все остановки,
+ * затем расстояния, затем маршруты
+ */
+void ApplyRecord(std::string_view record, tc::TransportCatalogue &catalogue)
+{
+    RecordReader reader(record);
+    const auto kind = reader.Get<RecordKind>();
+    const auto count = reader.Get<uint32_t>();
+
+    if (kind == RecordKind::PUT)
+    {
+        PutRecord put = ReadPut(reader, count);
+        CheckBusStops(put, catalogue);
+
+        std::vector<names::Name> stop_names;
+        stop_names.reserve(put.stops.size());
+
+        for (tc::Stop &stop : put.stops)
+        {
+            stop_names.push_back(stop.name);
+            catalogue.AddStop(std::move(stop));
+        }
+
+        for (size_t i = 0; i < stop_names.size(); ++i)
+        {
+            const tc::Stop *from = catalogue.GetStop(stop_names[i]);
+
+            for (const auto &[to_name, distance] : put.distances[i])
+            {
+                // Расстояние до остановки, которой ещё нет в справочнике, не к чему привязать
+                if (const tc::Stop *to = catalogue.GetStop(to_name))
+                {
+                    catalogue.SetDistance(from, to, distance);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < put.buses.size(); ++i)
+        {
+            for (const auto stop_name : put.bus_stops[i])
+            {
+                put.buses[i].stops.push_back(catalogue.GetStop(stop_name));
+            }
+
+            catalogue.AddBus(std::move(put.buses[i]));
+        }
+    }
+
+    else if (kind == RecordKind::PATCH)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const std::string bus_name(reader.GetString());
+            tc::Bus *bus = catalogue.GetBus(bus_name);
+
+            if (reader.Get<uint8_t>())
+            {
+                const auto pos = reader.Get<uint32_t>();
+                const auto stops_count = reader.Get<uint32_t>();
+
+                for (uint32_t j = 0; j < stops_count; ++j)
+                {
+                    const auto stop_name = reader.GetString();
+
+                    if (bus)
+                    {
+                        catalogue.UpdateBusStops(bus_name, stop_name, pos + j);
+                    }
+                }
+            }
+
+            if (reader.Get<uint8_t>())
+            {
+                const bool is_roundtrip = reader.Get<uint8_t>() != 0;
+
+                if (bus)
+                {
+                    bus->is_roundtrip = is_roundtrip;
+                }
+            }
+        }
+    }
+
+    else
+    {
+        throw std::runtime_error("unknown log record kind"s);
+    }
+}
+} // namespace wal
@@ -0,0 +1,81 @@
+#include "../include/name_pool.h"
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+namespace names
+{
+namespace
+{
+// Строки складываются в блоки этого размера; строка длиннее получает отдельный блок,
+// а следующие строки продолжают заполнять текущий
+constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+class NamePool
+{
+  public:
+    const char *Intern(std::string_view text)
+    {
+        std::lock_guard guard(mutex_);
+
+        if (const auto it = interned_.find(text); it != interned_.end())
+        {
+            return it->data();
+        }
+
+        if (text.size() > UINT32_MAX)
+        {
+            throw std::length_error("name is too long");
+        }
+
+        const size_t record_size = sizeof(uint32_t) + text.size();
+        char *record = nullptr;
+
+        if (record_size > BLOCK_SIZE)
+        {
+            oversized_.push_back(std::make_unique<char[]>(record_size));
+            record = oversized_.back().get();
+        }
+
+        else
+        {
+            if (used_ + record_size > BLOCK_SIZE)
+            {
+                blocks_.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+                used_ = 0;
+            }
+
+            record = blocks_.back().get() + used_;
+            used_ += record_size;
+        }
+
+        const auto size = static_cast<uint32_t>(text.size());
+        std::memcpy(record, &size, sizeof(size));
+        std::memcpy(record + sizeof(size), text.data(), text.size());
+
+        return interned_.emplace(record + sizeof(size), text.size()).first->data();
+    }
+
+  private:
+    std::mutex mutex_;
+    std::unordered_set<std::string_view> interned_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::vector<std::unique_ptr<char[]>> oversized_; // Строки длиннее блока, по одной на выделение
+    size_t used_ = BLOCK_SIZE;                       // Занято в последнем из blocks_
+};
+
+NamePool &GetPool()
+{
+    // Хранилище не разрушается: названия могут понадобиться деструкторам других статических объектов
+    static NamePool *pool = new NamePool;
+    return *pool;
+}
+} // namespace
+
+Name::Name(std::string_view text) : data_(text.empty() ? nullptr : GetPool().Intern(text))
+{
+}
+} // namespace names
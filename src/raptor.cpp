@@ -0,0 +1,213 @@
+#include "../include/raptor.h"
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace timetable
+{
+namespace
+{
+constexpr double UNREACHED = std::numeric_limits<double>::infinity();
+constexpr uint32_t NO_POSITION = std::numeric_limits<uint32_t>::max();
+// Меньше линий в раунде выгоднее просмотреть в одном потоке, чем запускать рабочие потоки
+constexpr size_t PARALLEL_MIN_LINE_COUNT = 256;
+
+// Как остановка достигнута в раунде: линия, позиции посадки и высадки, время отправления
+struct Parent
+{
+    uint32_t line;
+    uint32_t board;
+    uint32_t alight;
+    double departure;
+};
+
+struct Improvement
+{
+    uint32_t stop;
+    double arrival;
+    Parent parent;
+};
+} // namespace
+
+Raptor::Raptor(const Timetable &timetable, const tc::RoutingSettings &routing_settings)
+    : timetable_(timetable), bus_wait_time_(routing_settings.bus_wait_time_),
+      thread_count_(routing_settings.build_threads_)
+{
+}
+
+std::vector<Journey> Raptor::FindParetoJourneys(const tc::Stop *from, const tc::Stop *to,
+                                                std::optional<double> depart_at, size_t max_transfers) const
+{
+    const auto source = timetable_.FindStopIndex(from);
+    const auto target = timetable_.FindStopIndex(to);
+
+    if (!source || !target)
+    {
+        throw std::out_of_range("stop is not in timetable");
+    }
+
+    const auto &lines = timetable_.GetLines();
+    const size_t stop_count = timetable_.GetStopCount();
+    const double start = depart_at.value_or(0.0);
+
+    if (*source == *target)
+    {
+        return {Journey{start, start, {}}};
+    }
+
+    // Ближайшее отправление линии с остановки на позиции position для пассажира, пришедшего в time
+    auto next_departure = [this, &depart_at](const Line &line, size_t position, double time) {
+        return depart_at ? Timetable::NextDeparture(line, position, time) : std::optional<double>(time + bus_wait_time_);
+    };
+
+    // arrivals[k][s] — лучшее прибытие на s не больше чем с k поездками; parents[k][s] задан, если улучшено в раунде k
+    std::vector<std::vector<double>> arrivals{std::vector<double>(stop_count, UNREACHED)};
+    std::vector<std::vector<std::optional<Parent>>> parents{std::vector<std::optional<Parent>>(stop_count)};
+    std::vector<double> best(stop_count, UNREACHED);
+    std::vector<uint32_t> marked{*source};
+    std::vector<Journey> journeys;
+
+    arrivals[0][*source] = start;
+    best[*source] = start;
+
+    std::vector<uint32_t> first_positions(lines.size(), NO_POSITION);
+    std::vector<uint32_t> round_lines;
+    std::vector<char> is_marked(stop_count, false);
+
+    for (size_t round = 1; round <= max_transfers + 1 && !marked.empty(); ++round)
+    {
+        // Линии через отмеченные остановки и самая ранняя отмеченная позиция в каждой
+        round_lines.clear();
+
+        for (const uint32_t stop : marked)
+        {
+            for (const auto &[line, position] : timetable_.GetStopLines(stop))
+            {
+                if (first_positions[line] == NO_POSITION)
+                {
+                    round_lines.push_back(line);
+                }
+
+                first_positions[line] = std::min(first_positions[line], position);
+            }
+        }
+
+        const std::vector<double> &previous = arrivals.back();
+        const double best_target = best[*target];
+        std::vector<std::vector<Improvement>> improvements(round_lines.size());
+
+        auto scan_line = [&](size_t index) {
+            const uint32_t line_index = round_lines[index];
+            const Line &line = lines[line_index];
+            std::optional<Parent> trip;
+
+            for (uint32_t position = first_positions[line_index]; position < line.stops.size(); ++position)
+            {
+                const uint32_t stop = line.stops[position];
+                const double on_trip =
+                    trip ? trip->departure + line.offsets[position] - line.offsets[trip->board] : UNREACHED;
+
+                if (trip && on_trip < std::min(best[stop], best_target))
+                {
+                    improvements[index].push_back({stop, on_trip, {line_index, trip->board, position, trip->departure}});
+                }
+
+                if (previous[stop] == UNREACHED)
+                {
+                    continue;
+                }
+
+                // Пересесть на более ранний рейс этой линии, если до него можно успеть
+                if (const auto departure = next_departure(line, position, previous[stop]); departure && *departure < on_trip)
+                {
+                    trip = Parent{line_index, position, position, *departure};
+                }
+            }
+        };
+
+        if (thread_count_ > 1 && round_lines.size() >= PARALLEL_MIN_LINE_COUNT)
+        {
+            parallel::ParallelFor(round_lines.size(), thread_count_, scan_line);
+        }
+
+        else
+        {
+            for (size_t index = 0; index < round_lines.size(); ++index)
+            {
+                scan_line(index);
+            }
+        }
+
+        arrivals.push_back(arrivals.back());
+        parents.emplace_back(stop_count);
+        marked.clear();
+
+        for (const uint32_t line : round_lines)
+        {
+            first_positions[line] = NO_POSITION;
+        }
+
+        for (const auto &line_improvements : improvements)
+        {
+            for (const Improvement &improvement : line_improvements)
+            {
+                if (improvement.arrival < arrivals[round][improvement.stop])
+                {
+                    arrivals[round][improvement.stop] = improvement.arrival;
+                    parents[round][improvement.stop] = improvement.parent;
+                    best[improvement.stop] = std::min(best[improvement.stop], improvement.arrival);
+
+                    if (!is_marked[improvement.stop])
+                    {
+                        is_marked[improvement.stop] = true;
+                        marked.push_back(improvement.stop);
+                    }
+                }
+            }
+        }
+
+        for (const uint32_t stop : marked)
+        {
+            is_marked[stop] = false;
+        }
+
+        if (!(arrivals[round][*target] < best_target))
+        {
+            continue;
+        }
+
+        // Новая точка множества Парето: восстанавливаем маршрут, спускаясь по раундам
+        Journey journey{start, arrivals[round][*target], {}};
+        uint32_t stop = *target;
+
+        for (size_t k = round; k > 0; --k)
+        {
+            // Метка могла достаться от предыдущего раунда без изменений
+            while (k > 0 && !parents[k][stop])
+            {
+                --k;
+            }
+
+            if (k == 0)
+            {
+                break;
+            }
+
+            const Parent &parent = *parents[k][stop];
+            const Line &line = lines[parent.line];
+            const uint32_t board_stop = line.stops[parent.board];
+
+            journey.legs.push_back({line.bus, timetable_.GetStop(board_stop), timetable_.GetStop(stop),
+                                    parent.alight - parent.board, parent.departure, arrivals[k][stop]});
+            stop = board_stop;
+        }
+
+        std::reverse(journey.legs.begin(), journey.legs.end());
+        journeys.push_back(std::move(journey));
+    }
+
+    return journeys;
+}
+} // namespace timetable
@@ -2,9 +2,9 @@
 
 using namespace std::literals;
 
-const std::set<std::string> RequestHandler::GetBusesByStop(std::string_view stop_name) const
+ranges::Range<std::vector<names::Name>::const_iterator> RequestHandler::GetBusesByStop(std::string_view stop_name) const
 {
-    return catalogue_.GetStop(stop_name)->buses;
+    return ranges::AsRange(catalogue_.GetStop(stop_name)->buses);
 }
 
 const std::optional<graph::Router<double>::RouteInfo> RequestHandler::GetRoute(const tc::Stop *stop_from,
@@ -13,6 +13,74 @@ const std::optional<graph::Router<double>::RouteInfo> RequestHandler::GetRoute(c
     return router_.GetRoute(stop_from, stop_to);
 }
 
+std::optional<graph::MultiRouteInfo<double>> RequestHandler::GetRouteBetween(
+    const std::vector<std::pair<const tc::Stop *, double>> &stops_from,
+    const std::vector<std::pair<const tc::Stop *, double>> &stops_to) const
+{
+    return router_.GetRouteBetween(stops_from, stops_to);
+}
+
+std::vector<std::pair<const tc::Stop *, double>> RequestHandler::GetWalkingStops(geo::Coordinates point) const
+{
+    std::vector<std::pair<const tc::Stop *, double>> stops;
+
+    for (const auto &[stop, distance] :
+         catalogue_.GetStopIndex().FindNearest(point, router_.GetRoutingSettings().walk_stop_count_))
+    {
+        stops.emplace_back(stop, router_.GetWalkTime(distance));
+    }
+
+    return stops;
+}
+
+double RequestHandler::GetWalkTime(double distance) const
+{
+    return router_.GetWalkTime(distance);
+}
+
+const tc::Stop *RequestHandler::GetVertexStop(graph::VertexId vertex) const
+{
+    return router_.GetVertexStop(vertex);
+}
+
+std::vector<std::optional<double>> RequestHandler::GetRouteTimes(const tc::Stop *stop_from,
+                                                                 const std::vector<const tc::Stop *> &stops_to) const
+{
+    return router_.GetRouteTimes(stop_from, stops_to);
+}
+
+std::vector<std::pair<const tc::Stop *, double>> RequestHandler::GetReachableStops(const tc::Stop *stop_from,
+                                                                                   double max_time) const
+{
+    return router_.GetReachableStops(stop_from, max_time);
+}
+
+std::optional<timetable::Journey> RequestHandler::GetJourney(const tc::Stop *stop_from, const tc::Stop *stop_to,
+                                                            double depart_at) const
+{
+    return router_.GetJourney(stop_from, stop_to, depart_at);
+}
+
+std::vector<graph::Router<double>::RouteInfo> RequestHandler::GetAlternativeRoutes(const tc::Stop *stop_from,
+                                                                                  const tc::Stop *stop_to,
+                                                                                  size_t count,
+                                                                                  double max_stretch) const
+{
+    return router_.GetAlternativeRoutes(stop_from, stop_to, count, max_stretch);
+}
+
+std::vector<timetable::Journey> RequestHandler::GetParetoJourneys(const tc::Stop *stop_from, const tc::Stop *stop_to,
+                                                                 std::optional<double> depart_at,
+                                                                 size_t max_transfers) const
+{
+    return router_.GetParetoJourneys(stop_from, stop_to, depart_at, max_transfers);
+}
+
+const tc::RoutingSettings &RequestHandler::GetRoutingSettings() const
+{
+    return router_.GetRoutingSettings();
+}
+
 const graph::DirectedWeightedGraph<double> &RequestHandler::GetGraph() const
 {
     return router_.GetRouteGraph();
@@ -21,4 +89,19 @@ const graph::DirectedWeightedGraph<double> &RequestHandler::GetGraph() const
 svg::Document RequestHandler::RenderMap() const
 {
     return renderer_.GetSVG(catalogue_.GetAllBuses());
+}
+
+std::shared_ptr<const cache::PrintedAnswer> RequestHandler::FindCachedRoute(const tc::Stop *stop_from,
+                                                                            const tc::Stop *stop_to) const
+{
+    return route_cache_ ? route_cache_->Find(stop_from, stop_to, router_.GetGeneration()) : nullptr;
+}
+
+void RequestHandler::CacheRoute(const tc::Stop *stop_from, const tc::Stop *stop_to,
+                                std::shared_ptr<const cache::PrintedAnswer> answer) const
+{
+    if (route_cache_)
+    {
+        route_cache_->Insert(stop_from, stop_to, router_.GetGeneration(), std::move(answer));
+    }
 }
\ No newline at end of file
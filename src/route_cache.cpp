@@ -0,0 +1,129 @@
+#include "../include/route_cache.h"
+
+#include <algorithm>
+
+namespace cache
+{
+RouteCache::RouteCache(size_t capacity, size_t shard_count)
+{
+    shard_count = std::max<size_t>(1, std::min(shard_count, capacity));
+    shard_capacity_ = capacity == 0 ? 0 : (capacity + shard_count - 1) / shard_count;
+    shards_.reserve(shard_count);
+
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+RouteCache::Shard &RouteCache::GetShard(const Key &key)
+{
+    return *shards_[KeyHasher{}(key) % shards_.size()];
+}
+
+bool RouteCache::SyncGeneration(Shard &shard, uint64_t generation)
+{
+    if (generation < shard.generation)
+    {
+        return false;
+    }
+
+    if (generation > shard.generation)
+    {
+        shard.entries.clear();
+        shard.index.clear();
+        shard.generation = generation;
+    }
+
+    return true;
+}
+
+std::shared_ptr<const PrintedAnswer> RouteCache::Find(const tc::Stop *from, const tc::Stop *to, uint64_t generation)
+{
+    const Key key{from, to};
+    Shard &shard = GetShard(key);
+
+    {
+        std::lock_guard lock(shard.mutex);
+
+        if (SyncGeneration(shard, generation))
+        {
+            if (auto it = shard.index.find(key); it != shard.index.end())
+            {
+                shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+                ++hits_;
+
+                return it->second->answer;
+            }
+        }
+    }
+
+    ++misses_;
+
+    return nullptr;
+}
+
+void RouteCache::Insert(const tc::Stop *from, const tc::Stop *to, uint64_t generation,
+                        std::shared_ptr<const PrintedAnswer> answer)
+{
+    if (shard_capacity_ == 0)
+    {
+        return;
+    }
+
+    const Key key{from, to};
+    Shard &shard = GetShard(key);
+    std::lock_guard lock(shard.mutex);
+
+    if (!SyncGeneration(shard, generation))
+    {
+        return;
+    }
+
+    // Ответ мог быть добавлен другим потоком, пока этот его вычислял
+    if (auto it = shard.index.find(key); it != shard.index.end())
+    {
+        it->second->answer = std::move(answer);
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+
+        return;
+    }
+
+    shard.entries.push_front({key, std::move(answer)});
+    shard.index.emplace(key, shard.entries.begin());
+
+    if (shard.entries.size() > shard_capacity_)
+    {
+        shard.index.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+        ++evictions_;
+    }
+}
+
+void RouteCache::Clear()
+{
+    for (auto &shard : shards_)
+    {
+        std::lock_guard lock(shard->mutex);
+        shard->entries.clear();
+        shard->index.clear();
+    }
+}
+
+RouteCacheStats RouteCache::GetStats() const
+{
+    RouteCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.capacity = shard_capacity_ * shards_.size();
+
+    for (const auto &shard : shards_)
+    {
+        std::lock_guard lock(shard->mutex);
+        stats.size += shard->entries.size();
+    }
+
+    return stats;
+}
+} // namespace cache
@@ -5,8 +5,19 @@ void RegisterLoadEndpoints(httplib::Server &svr, ServerState &state)
     svr.Post("/load", [&state](const httplib::Request &req, httplib::Response &res) {
         try
         {
-            HandleLoad(req.body, state);
-            res.set_content("{\"status\":\"ok\"}", "application/json");
+            res.set_content(HandleLoad(req.body, state), "application/json");
+        }
+        catch (const std::exception &e)
+        {
+            res.status = 500;
+            res.set_content(std::string("{\"error\":\"") + e.what() + "\"}", "application/json");
+        }
+    });
+
+    svr.Put("/routing_settings", [&state](const httplib::Request &req, httplib::Response &res) {
+        try
+        {
+            res.set_content(HandleRoutingSettings(req.body, state), "application/json");
         }
         catch (const std::exception &e)
         {
@@ -20,6 +31,9 @@ void RegisterQueryEndpoints(httplib::Server &svr, ServerState &state)
 {
     svr.Post("/query",
              [&state](const httplib::Request &req, httplib::Response &res) { HandleQuery(req.body, res, state); });
+
+    svr.Get("/stats/route_cache",
+            [&state](const httplib::Request &, httplib::Response &res) { HandleRouteCacheStats(res, state); });
 }
 
 void RegisterMapEndpoints(httplib::Server &svr, ServerState &state)
@@ -73,4 +87,33 @@ void RegisterPatchEndpoints(httplib::Server &svr, ServerState &state)
             res.set_content(std::string("{\"error\":\"") + e.what() + "\"}", "application/json");
         }
     });
-}
\ No newline at end of file
+}
+
+void RegisterImageEndpoints(httplib::Server &svr, ServerState &state)
+{
+    svr.Post("/image/save", [&state](const httplib::Request &req, httplib::Response &res) {
+        try
+        {
+            HandleSaveImage(req.body, state);
+            res.set_content("{\"status\":\"ok\"}", "application/json");
+        }
+        catch (const std::exception &e)
+        {
+            res.status = 500;
+            res.set_content(std::string("{\"error\":\"") + e.what() + "\"}", "application/json");
+        }
+    });
+
+    svr.Post("/image/open", [&state](const httplib::Request &req, httplib::Response &res) {
+        try
+        {
+            HandleOpenImage(ParseImagePath(req.body), state);
+            res.set_content("{\"status\":\"ok\"}", "application/json");
+        }
+        catch (const std::exception &e)
+        {
+            res.status = 500;
+            res.set_content(std::string("{\"error\":\"") + e.what() + "\"}", "application/json");
+        }
+    });
+}
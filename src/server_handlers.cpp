@@ -1,25 +1,394 @@
 #include "../include/server_handlers.h"
+#include "../include/catalogue_loader.h"
+#include "../include/json_builder.h"
 #include "../include/json_reader.h"
+#include <chrono>
 #include <cstddef>
+#include <memory_resource>
+#include <unordered_map>
+#include <sys/stat.h>
 
-void HandleLoad(const std::string &body, ServerState &state)
+namespace
 {
+// Разобранный документ запросов занимает в памяти в 3-8 раз больше исходного текста
+constexpr size_t QUERY_ARENA_SIZE_FACTOR = 4;
+
+void CheckWritable(const ServerState &state)
+{
+    if (state.read_only)
+    {
+        throw std::logic_error("catalogue is read-only"s);
+    }
+}
+
+std::string MakeRenderSettingsDocument(const ServerState &state)
+{
+    std::ostringstream render_settings;
+    json::Print(json::Document{json::Builder{}
+                                   .StartDict()
+                                   .Key("render_settings")
+                                   .Value(state.json_reader->GetRenderSettings().GetValue())
+                                   .EndDict()
+                                   .Build()},
+                render_settings);
+
+    return render_settings.str();
+}
+
+// Копия справочника для снимка, который строится без блокировки состояния сервера
+std::unique_ptr<tc::TransportCatalogue> CopyCatalogue(const tc::TransportCatalogue &catalogue)
+{
+    auto copy = std::make_unique<tc::TransportCatalogue>();
+    std::unordered_map<const tc::Stop *, const tc::Stop *> stops;
+
+    for (const auto &[name, stop] : catalogue.GetAllStops())
+    {
+        copy->AddStop({stop->name, stop->coordinates, {}});
+        stops[stop] = copy->GetStop(name);
+    }
+
+    for (const auto &[stops_pair, distance] : catalogue.GetAllDistances())
+    {
+        copy->SetDistance(stops.at(stops_pair.first), stops.at(stops_pair.second), distance);
+    }
+
+    for (const auto &[number, bus] : catalogue.GetAllBuses())
+    {
+        tc::Bus bus_copy{bus->number, {}, bus->is_roundtrip};
+
+        for (const tc::Stop *stop : bus->stops)
+        {
+            bus_copy.stops.push_back(stops.at(stop));
+        }
+
+        copy->AddBus(std::move(bus_copy));
+    }
+
+    return copy;
+}
+
+// Всё, что нужно снимку, снятое под блокировкой состояния сервера
+struct SnapshotSource
+{
+    std::unique_ptr<tc::TransportCatalogue> catalogue;
+    std::shared_ptr<const tc::TransportRouter> router; // nullptr — маршрутизатор устарел и строится по копии
+    tc::RoutingSettings routing_settings;
+    std::string render_settings;
+    wal::LogPosition position;
+};
+
+SnapshotSource TakeSnapshotSource(const ServerState &state)
+{
+    return {CopyCatalogue(*state.catalogue), state.router_stale ? nullptr : state.router,
+            state.router->GetRoutingSettings(), MakeRenderSettingsDocument(state),
+            state.log->GetPosition(state.applied_seq)};
+}
+
+/*
+ * Записывает снимок без блокировки состояния сервера: запросы и изменения его не ждут. Затем под исключительной
+ * блокировкой снимок заменяет прежний, а журнал начинает новое поколение с записей после source.position.
+ * Вызывается под state.snapshot_mutex
+ */
+void WriteSnapshot(ServerState &state, SnapshotSource source)
+{
+    if (!source.router)
+    {
+        source.router = std::make_shared<const tc::TransportRouter>(source.routing_settings, *source.catalogue);
+    }
+
+    const std::string tmp_path = state.snapshot_path + ".snapshot"s;
+    image::WriteImage(tmp_path, *source.catalogue, *source.router, source.render_settings,
+                      source.position.generation, source.position.records);
+
+    std::unique_lock lock(state.mutex);
+
+    // Поколение журнала меняют только снимки, а они пишутся по одному
+    if (state.log->GetGeneration() != source.position.generation)
+    {
+        std::remove(tmp_path.c_str());
+        throw std::logic_error("log generation changed while the snapshot was written"s);
+    }
+
+    image::ReplaceImage(tmp_path, state.snapshot_path);
+    state.log->Rotate(source.position);
+}
+
+// Создаёт обработчик запросов для нового маршрутизатора; ответы прежнего из кэша больше не нужны
+void ResetRequestHandler(ServerState &state)
+{
+    state.route_cache->Clear();
+    state.request_handler =
+        std::make_unique<RequestHandler>(*state.catalogue, *state.renderer, *state.router, state.route_cache.get());
+}
+
+void ApplyRecord(ServerState &state, std::string_view record)
+{
+    wal::ApplyRecord(record, *state.catalogue);
+    state.map_svg.clear();
+    state.router_stale = true;
+    ++state.version;
+}
+
+/*
+ * Изменение справочника кодируется записью журнала и применяется функцией восстановления из журнала:
+ * после перезапуска справочник совпадает с тем, что видели запросы до него. Запросам изменение видно только
+ * после того, как его запись оказалась на диске: сбой записи не оставит в справочнике того, чего нет в журнале
+ */
+void ApplyMutation(const std::string &body, ServerState &state, std::string (*encode)(const json::Array &))
+{
+    std::shared_lock mutation_lock(state.mutation_mutex);
+    std::unique_lock lock(state.mutex);
+    CheckWritable(state);
+
+    if (!state.catalogue)
+    {
+        return;
+    }
+
+    std::istringstream input(body);
+    json::Document doc = json::Load(input);
+    const std::string record = encode(doc.GetRoot().AsDict().at("base_requests").AsArray());
+
+    if (!state.log)
+    {
+        ApplyRecord(state, record);
+        return;
+    }
+
+    state.log->CheckWritable();
+    wal::CheckRecord(record, *state.catalogue);
+    const uint64_t seq = state.log->Append(record);
+    lock.unlock();
+
+    std::exception_ptr error;
+
+    try
+    {
+        state.log->WaitDurable(seq);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    lock.lock();
+    // Отклонённая запись только пропускает свою очередь, иначе следующие ждали бы её вечно
+    state.applied_cv.wait(lock, [&state, seq] { return state.applied_seq + 1 == seq; });
+
+    if (!error)
+    {
+        try
+        {
+            ApplyRecord(state, record);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+
+    state.applied_seq = seq;
+    state.applied_cv.notify_all();
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void OpenImage(const std::string &path, ServerState &state, bool read_only)
+{
+    auto catalogue_image = std::make_shared<const image::CatalogueImage>(path);
+    auto catalogue = std::make_unique<tc::TransportCatalogue>();
+    catalogue_image->FillTransportCatalogue(*catalogue);
+
+    std::istringstream input{std::string(catalogue_image->GetRenderSettings())};
+    auto reader = std::make_unique<json_reader::JsonReader>(input);
+    auto renderer = std::make_unique<renderer::MapRenderer>(reader->FillRenderSettings(reader->GetRenderSettings()));
+    auto router = std::make_unique<tc::TransportRouter>(catalogue_image, *catalogue);
+
+    state.request_handler.reset();
+    state.router = std::move(router);
+    state.renderer = std::move(renderer);
+    state.catalogue = std::move(catalogue);
+    state.json_reader = std::move(reader);
+    state.image = std::move(catalogue_image);
+    state.map_svg.clear();
+    state.router_stale = false;
+    ++state.version;
+    ResetRequestHandler(state);
+    state.read_only = read_only;
+}
+/*
+ * Ответы на запросы должны совпадать с ответами сервера, перезапущенного с тем же журналом, а он строит
+ * маршрутизатор по восстановленному справочнику. Поэтому маршрутизатор, устаревший после PUT/PATCH,
+ * перестраивается перед ответом. Строится он под разделяемой блокировкой: запросы на чтение не ждут
+ */
+void RefreshRouter(ServerState &state)
+{
+    std::lock_guard build_lock(state.router_mutex);
+
+    while (true)
+    {
+        std::shared_lock lock(state.mutex);
+
+        if (!state.router_stale || !state.router || !state.catalogue)
+        {
+            return;
+        }
+
+        const uint64_t version = state.version;
+        auto router = std::make_unique<tc::TransportRouter>(state.router->GetRoutingSettings(), *state.catalogue);
+        lock.unlock();
+
+        std::unique_lock write_lock(state.mutex);
+
+        // Справочник изменился, пока строился маршрутизатор: строим заново
+        if (state.version == version)
+        {
+            state.request_handler.reset();
+            state.router = std::move(router);
+            state.router_stale = false;
+            ResetRequestHandler(state);
+            return;
+        }
+    }
+}
+} // namespace
+
+std::string HandleLoad(const std::string &body, ServerState &state)
+{
+    std::unique_lock mutation_lock(state.mutation_mutex);
+    std::lock_guard snapshot_lock(state.snapshot_mutex);
+    std::unique_lock lock(state.mutex);
+    CheckWritable(state);
+
     std::istringstream input(body);
-    state.catalogue = std::make_unique<tc::TransportCatalogue>();
-    state.json_reader = std::make_unique<json_reader::JsonReader>(input);
-    state.json_reader->FillTransportCatalogue(*state.catalogue);
+    loader::LoadResult result = loader::LoadCatalogue(input);
+
+    state.request_handler.reset();
+    state.router = std::move(result.router);
+    state.renderer = std::move(result.renderer);
+    state.catalogue = std::move(result.catalogue);
+    state.json_reader = std::move(result.json_reader);
+    state.map_svg = std::move(result.map_svg);
+    state.router_stale = false;
+    ++state.version;
+    ResetRequestHandler(state);
+
+    if (state.log)
+    {
+        SnapshotSource source = TakeSnapshotSource(state);
+        lock.unlock();
+        WriteSnapshot(state, std::move(source));
+    }
+
+    const loader::LoadTimings &timings = result.timings;
+    std::ostringstream response;
+    json::Print(json::Document{json::Builder{}
+                                   .StartDict()
+                                   .Key("status")
+                                   .Value("ok"s)
+                                   .Key("timings")
+                                   .StartDict()
+                                   .Key("parse_ms")
+                                   .Value(timings.parse)
+                                   .Key("build_ms")
+                                   .Value(timings.build)
+                                   .Key("settings_ms")
+                                   .Value(timings.settings)
+                                   .Key("router_ms")
+                                   .Value(timings.router)
+                                   .Key("map_ms")
+                                   .Value(timings.map)
+                                   .Key("total_ms")
+                                   .Value(timings.total)
+                                   .EndDict()
+                                   .EndDict()
+                                   .Build()},
+                response);
+
+    return response.str();
+}
+
+std::string HandleRoutingSettings(const std::string &body, ServerState &state)
+{
+    std::unique_lock mutation_lock(state.mutation_mutex);
+    std::lock_guard snapshot_lock(state.snapshot_mutex);
+    std::unique_lock lock(state.mutex);
+    CheckWritable(state);
+
+    if (!state.catalogue || !state.router)
+    {
+        throw std::logic_error("catalogue not loaded"s);
+    }
+
+    std::istringstream input(body);
+    json::Document doc = json::Load(input);
+    const json::Dict &request = doc.GetRoot().AsDict().at("routing_settings"s).AsDict();
+    tc::RoutingSettings routing_settings = state.router->GetRoutingSettings();
+
+    if (request.count("bus_wait_time"s))
+    {
+        routing_settings.bus_wait_time_ = request.at("bus_wait_time"s).AsInt();
+    }
+
+    if (request.count("bus_velocity"s))
+    {
+        routing_settings.bus_velocity_ = request.at("bus_velocity"s).AsDouble();
+
+        if (routing_settings.bus_velocity_ <= 0.0)
+        {
+            throw std::invalid_argument("bus_velocity must be positive"s);
+        }
+    }
+
+    // С разбиением на ячейки достаточно пересчитать клики, иначе маршрутизатор строится заново.
+    // Разбиение прежнего маршрутизатора годится, только пока PUT/PATCH не изменили остановки и маршруты
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<tc::TransportRouter> router =
+        routing_settings.route_engine_ == tc::RouteEngine::CRP && !state.router_stale
+            ? std::make_unique<tc::TransportRouter>(*state.router, routing_settings, *state.catalogue)
+            : std::make_unique<tc::TransportRouter>(routing_settings, *state.catalogue);
+    const double router_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-    renderer::RenderSettings settings = state.json_reader->FillRenderSettings(state.json_reader->GetRenderSettings());
-    state.renderer = std::make_unique<renderer::MapRenderer>(settings);
+    state.request_handler.reset();
+    state.router = std::move(router);
+    state.router_stale = false;
+    ++state.version;
+    ResetRequestHandler(state);
+
+    if (state.log)
+    {
+        SnapshotSource source = TakeSnapshotSource(state);
+        lock.unlock();
+        WriteSnapshot(state, std::move(source));
+    }
 
-    auto routing_settings = state.json_reader->FillRoutingSettings(state.json_reader->GetRoutingSettings());
-    state.router = std::make_unique<tc::TransportRouter>(routing_settings, *state.catalogue);
+    std::ostringstream response;
+    json::Print(
+        json::Document{
+            json::Builder{}.StartDict().Key("status").Value("ok"s).Key("router_ms").Value(router_ms).EndDict().Build()},
+        response);
 
-    state.request_handler = std::make_unique<RequestHandler>(*state.catalogue, *state.renderer, *state.router);
+    return response.str();
 }
 
 void HandleQuery(const std::string &body, httplib::Response &res, ServerState &state)
 {
+    try
+    {
+        RefreshRouter(state);
+    }
+    catch (const std::exception &e)
+    {
+        res.status = 500;
+        res.set_content(std::string("{\"error\":\"") + e.what() + "\"}", "application/json");
+        return;
+    }
+
+    std::shared_lock lock(state.mutex);
+
     if (!state.request_handler)
     {
         res.status = 400;
@@ -32,7 +401,9 @@ void HandleQuery(const std::string &body, httplib::Response &res, ServerState &s
         std::istringstream input(body);
         std::ostringstream output;
 
-        json_reader::JsonReader document(input);
+        // Все узлы разобранного запроса — в одном буфере, который освобождается целиком в конце запроса
+        std::pmr::monotonic_buffer_resource arena(body.size() * QUERY_ARENA_SIZE_FACTOR + 1);
+        json_reader::JsonReader document(input, &arena);
         document.ProcessRequests(document.GetStatRequests(), *state.catalogue, *state.request_handler, output);
 
         res.set_content(output.str(), "application/json");
@@ -44,8 +415,33 @@ void HandleQuery(const std::string &body, httplib::Response &res, ServerState &s
     }
 }
 
+void HandleRouteCacheStats(httplib::Response &res, ServerState &state)
+{
+    const cache::RouteCacheStats stats = state.route_cache->GetStats();
+    std::ostringstream output;
+    json::Print(json::Document{json::Builder{}
+                                   .StartDict()
+                                   .Key("hits")
+                                   .Value(static_cast<double>(stats.hits))
+                                   .Key("misses")
+                                   .Value(static_cast<double>(stats.misses))
+                                   .Key("evictions")
+                                   .Value(static_cast<double>(stats.evictions))
+                                   .Key("size")
+                                   .Value(static_cast<int>(stats.size))
+                                   .Key("capacity")
+                                   .Value(static_cast<int>(stats.capacity))
+                                   .EndDict()
+                                   .Build()},
+                output);
+
+    res.set_content(output.str(), "application/json");
+}
+
 void HandleMap(httplib::Response &res, ServerState &state)
 {
+    std::shared_lock lock(state.mutex);
+
     if (!state.renderer || !state.catalogue)
     {
         res.status = 400;
@@ -53,6 +449,12 @@ void HandleMap(httplib::Response &res, ServerState &state)
         return;
     }
 
+    if (!state.map_svg.empty())
+    {
+        res.set_content(state.map_svg, "image/svg+xml");
+        return;
+    }
+
     try
     {
         auto svg_doc = state.renderer->GetSVG(state.catalogue->GetAllBuses());
@@ -70,89 +472,110 @@ void HandleMap(httplib::Response &res, ServerState &state)
 
 void HandlePutStop(const std::string &body, ServerState &state)
 {
-    if (!state.catalogue || !state.json_reader)
-        return;
-
-    std::istringstream input(body);
-    json::Document doc = json::Load(input);
-    const auto &base_requests = doc.GetRoot().AsDict().at("base_requests").AsArray();
-
-    for (const auto &request : base_requests)
-    {
-        state.json_reader->ParseRequest(request);
-    }
-
-    state.json_reader->ApplyCommands(*state.catalogue);
+    ApplyMutation(body, state, wal::EncodePut);
 }
 
 void HandlePutBus(const std::string &body, ServerState &state)
 {
-    if (!state.catalogue || !state.json_reader)
-        return;
+    ApplyMutation(body, state, wal::EncodePut);
+}
 
+void HandlePatch(const std::string &body, ServerState &state)
+{
+    ApplyMutation(body, state, wal::EncodePatch);
+}
+
+std::string ParseImagePath(const std::string &body)
+{
     std::istringstream input(body);
     json::Document doc = json::Load(input);
-    const auto &base_requests = doc.GetRoot().AsDict().at("base_requests").AsArray();
 
-    for (const auto &request : base_requests)
+    return doc.GetRoot().AsDict().at("path").AsString();
+}
+
+void HandleSaveImage(const std::string &body, ServerState &state)
+{
+    std::shared_lock lock(state.mutex);
+
+    if (!state.catalogue || !state.router || !state.json_reader)
     {
-        state.json_reader->ParseRequest(request);
+        throw std::logic_error("catalogue not loaded"s);
     }
 
-    state.json_reader->ApplyCommands(*state.catalogue);
+    image::WriteImage(ParseImagePath(body), *state.catalogue, *state.router, MakeRenderSettingsDocument(state));
 }
 
-void HandlePatch(const std::string &body, ServerState &state)
+void HandleOpenImage(const std::string &path, ServerState &state)
+{
+    std::lock_guard snapshot_lock(state.snapshot_mutex);
+    std::unique_lock lock(state.mutex);
+    OpenImage(path, state, true);
+}
+
+void HandleRestore(const std::string &data_dir, const wal::LogSettings &settings, ServerState &state)
 {
-    if (!state.catalogue || !state.json_reader)
+    std::unique_lock lock(state.mutex);
+    state.snapshot_path = data_dir + "/snapshot.img"s;
+    state.log = std::make_unique<wal::MutationLog>(data_dir + "/wal.log"s, settings);
+    state.applied_seq = state.log->GetLastSeq();
+
+    const auto records = state.log->TakeRecoveredRecords();
+    struct stat st;
+
+    if (::stat(state.snapshot_path.c_str(), &st) != 0)
     {
+        // Без снимка применять изменения не к чему: они относились к справочнику, который не был сохранён
+        state.log->Reset(state.log->GetGeneration());
         return;
     }
 
-    std::istringstream input(body);
-    json::Document doc = json::Load(input);
-    const auto &base_requests = doc.GetRoot().AsDict().at("base_requests").AsArray();
+    OpenImage(state.snapshot_path, state, false);
 
-    for (const auto &req : base_requests)
-    {
-        const auto &request = req.AsDict();
-        const auto type = request.at("type").AsString();
+    const uint64_t image_generation = state.image->GetLogGeneration();
+    size_t applied = 0;
 
-        if (type == "Bus")
-        {
-            HandlePatchBus(request, state);
-        }
+    // Снимок учёл начало поколения image_generation; следующее поколение целиком написано после снимка
+    if (state.log->GetGeneration() == image_generation)
+    {
+        // Сбой между заменой снимка и поворотом журнала
+        applied = std::min<uint64_t>(state.image->GetLogRecords(), records.size());
     }
-}
 
-void HandlePatchBus(const json::Dict &request, ServerState &state)
-{
-    const auto bus_name = request.at("name").AsString();
-    auto bus = state.catalogue->GetBus(bus_name);
+    else if (state.log->GetGeneration() != image_generation + 1)
+    {
+        state.log->Reset(image_generation + 1);
+        return;
+    }
 
-    if (!bus)
+    if (applied == records.size())
     {
         return;
     }
 
-    if (request.count("stops"))
+    for (size_t i = applied; i < records.size(); ++i)
     {
-        size_t pos = 0;
+        wal::ApplyRecord(records[i], *state.catalogue);
+    }
 
-        if (request.count("position"))
-        {
-            pos = static_cast<size_t>(request.at("position").AsInt());
-        }
+    state.request_handler.reset();
+    state.router = std::make_unique<tc::TransportRouter>(state.router->GetRoutingSettings(), *state.catalogue);
+    ResetRequestHandler(state);
+}
 
-        const auto &stops = request.at("stops").AsArray();
-        for (size_t i = 0; i < stops.size(); i++)
-        {
-            state.catalogue->UpdateBusStops(bus_name, stops[i].AsString(), pos + i);
-        }
-    }
+void HandleCompaction(ServerState &state)
+{
+    std::lock_guard snapshot_lock(state.snapshot_mutex);
+    std::shared_lock lock(state.mutex);
 
-    if (request.count("is_roundtrip"))
+    // После сбоя записи журнала снимок нужен и без новых записей: только он возвращает журналу изменения
+    if (!state.log || !state.catalogue || !state.router || state.read_only ||
+        (state.log->GetSize() == 0 && !state.log->IsFailed()))
     {
-        bus->is_roundtrip = request.at("is_roundtrip").AsBool();
+        return;
     }
-}
\ No newline at end of file
+
+    // Устаревший после PUT/PATCH маршрутизатор строится заново по копии справочника, актуальный берётся как есть
+    SnapshotSource source = TakeSnapshotSource(state);
+    lock.unlock();
+    WriteSnapshot(state, std::move(source));
+}
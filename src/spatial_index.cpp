@@ -0,0 +1,273 @@
+#include "../include/spatial_index.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace spatial
+{
+namespace
+{
+// Буфер новых остановок не меньше этого размера перед перестроением дерева
+constexpr size_t MIN_PENDING_SIZE = 64;
+
+double GetAxis(const geo::SpherePoint &point, uint8_t axis)
+{
+    return axis == 0 ? point.x : axis == 1 ? point.y : point.z;
+}
+
+double SquaredChord(const geo::SpherePoint &lhs, const geo::SpherePoint &rhs)
+{
+    const double dx = lhs.x - rhs.x;
+    const double dy = lhs.y - rhs.y;
+    const double dz = lhs.z - rhs.z;
+
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// nearest — куча из не больше count кандидатов с самым дальним наверху
+void OfferNearest(std::vector<std::pair<double, const tc::Stop *>> &nearest, size_t count, double square,
+                  const tc::Stop *stop)
+{
+    const auto farther = [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; };
+
+    if (nearest.size() == count && !(square < nearest.front().first))
+    {
+        return;
+    }
+
+    if (nearest.size() == count)
+    {
+        std::pop_heap(nearest.begin(), nearest.end(), farther);
+        nearest.pop_back();
+    }
+
+    nearest.emplace_back(square, stop);
+    std::push_heap(nearest.begin(), nearest.end(), farther);
+}
+
+// Расстояния в метрах от point до остановок кандидатов, одним пакетом
+std::vector<double> ComputeDistances(const geo::SpherePoint &point,
+                                     const std::vector<std::pair<double, const tc::Stop *>> &candidates)
+{
+    geo::CoordinateBatch stop_points;
+    std::vector<double> distances;
+
+    for (const auto &[square, stop] : candidates)
+    {
+        stop_points.Add(stop->sphere_point);
+    }
+
+    stop_points.ComputeDistancesTo(point, distances);
+
+    return distances;
+}
+} // namespace
+
+void StopIndex::Add(const tc::Stop *stop)
+{
+    pending_.push_back({stop->sphere_point, stop, 0});
+
+    if (pending_.size() + removed_.size() >= std::max(MIN_PENDING_SIZE, tree_.size() / 8))
+    {
+        Rebuild();
+    }
+}
+
+void StopIndex::Remove(const tc::Stop *stop)
+{
+    removed_.insert(stop);
+}
+
+size_t StopIndex::GetSize() const
+{
+    return tree_.size() + pending_.size() - removed_.size();
+}
+
+void StopIndex::Rebuild()
+{
+    tree_.insert(tree_.end(), pending_.begin(), pending_.end());
+    pending_.clear();
+
+    if (!removed_.empty())
+    {
+        tree_.erase(std::remove_if(tree_.begin(), tree_.end(),
+                                   [this](const Node &node) { return removed_.count(node.stop) > 0; }),
+                    tree_.end());
+        removed_.clear();
+    }
+
+    Build(0, tree_.size());
+}
+
+bool StopIndex::IsRemoved(const tc::Stop *stop) const
+{
+    return !removed_.empty() && removed_.count(stop) > 0;
+}
+
+void StopIndex::Build(size_t begin, size_t end)
+{
+    if (end - begin <= 1)
+    {
+        return;
+    }
+
+    // Делим по оси, вдоль которой точки отрезка разбросаны сильнее всего
+    geo::SpherePoint low = tree_[begin].point;
+    geo::SpherePoint high = low;
+
+    for (size_t i = begin + 1; i < end; ++i)
+    {
+        const geo::SpherePoint &point = tree_[i].point;
+        low = {std::min(low.x, point.x), std::min(low.y, point.y), std::min(low.z, point.z)};
+        high = {std::max(high.x, point.x), std::max(high.y, point.y), std::max(high.z, point.z)};
+    }
+
+    const double spans[] = {high.x - low.x, high.y - low.y, high.z - low.z};
+    const auto axis = static_cast<uint8_t>(std::max_element(std::begin(spans), std::end(spans)) - std::begin(spans));
+    const size_t middle = begin + (end - begin) / 2;
+
+    std::nth_element(tree_.begin() + begin, tree_.begin() + middle, tree_.begin() + end,
+                     [axis](const Node &lhs, const Node &rhs) {
+                         return GetAxis(lhs.point, axis) < GetAxis(rhs.point, axis);
+                     });
+
+    tree_[middle].axis = axis;
+    Build(begin, middle);
+    Build(middle + 1, end);
+}
+
+void StopIndex::SearchNearest(size_t begin, size_t end, const geo::SpherePoint &point, size_t count,
+                              Candidates &nearest) const
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    const size_t middle = begin + (end - begin) / 2;
+    const Node &node = tree_[middle];
+
+    if (!IsRemoved(node.stop))
+    {
+        OfferNearest(nearest, count, SquaredChord(point, node.point), node.stop);
+    }
+
+    const double offset = GetAxis(point, node.axis) - GetAxis(node.point, node.axis);
+    const bool left_first = offset < 0;
+
+    SearchNearest(left_first ? begin : middle + 1, left_first ? middle : end, point, count, nearest);
+
+    // Другая половина дальше плоскости разбиения: заходим, только если там может оказаться кто-то ближе
+    if (nearest.size() < count || offset * offset < nearest.front().first)
+    {
+        SearchNearest(left_first ? middle + 1 : begin, left_first ? end : middle, point, count, nearest);
+    }
+}
+
+void StopIndex::SearchRadius(size_t begin, size_t end, const geo::SpherePoint &point, double max_square,
+                             Candidates &found) const
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    const size_t middle = begin + (end - begin) / 2;
+    const Node &node = tree_[middle];
+
+    if (const double square = SquaredChord(point, node.point); square <= max_square && !IsRemoved(node.stop))
+    {
+        found.emplace_back(square, node.stop);
+    }
+
+    const double offset = GetAxis(point, node.axis) - GetAxis(node.point, node.axis);
+
+    if (offset < 0 || offset * offset <= max_square)
+    {
+        SearchRadius(begin, middle, point, max_square, found);
+    }
+
+    if (offset >= 0 || offset * offset <= max_square)
+    {
+        SearchRadius(middle + 1, end, point, max_square, found);
+    }
+}
+
+StopIndex::StopDistances StopIndex::FindNearest(geo::Coordinates coordinates, size_t count) const
+{
+    const geo::SpherePoint point = geo::ToSpherePoint(coordinates);
+    Candidates nearest;
+
+    if (count == 0)
+    {
+        return {};
+    }
+
+    nearest.reserve(count + 1);
+    SearchNearest(0, tree_.size(), point, count, nearest);
+
+    for (const Node &node : pending_)
+    {
+        if (!IsRemoved(node.stop))
+        {
+            OfferNearest(nearest, count, SquaredChord(point, node.point), node.stop);
+        }
+    }
+
+    const std::vector<double> distances = ComputeDistances(point, nearest);
+    StopDistances result;
+    result.reserve(nearest.size());
+
+    for (size_t i = 0; i < nearest.size(); ++i)
+    {
+        result.emplace_back(nearest[i].second, distances[i]);
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto &lhs, const auto &rhs) {
+        return std::tie(lhs.second, lhs.first->name) < std::tie(rhs.second, rhs.first->name);
+    });
+
+    return result;
+}
+
+StopIndex::StopDistances StopIndex::FindInRadius(geo::Coordinates coordinates, double radius) const
+{
+    const geo::SpherePoint point = geo::ToSpherePoint(coordinates);
+    // Небольшой запас по хорде, окончательно отбираем по расстоянию в метрах
+    const double chord = geo::DistanceToChord(radius) * (1.0 + 1e-9);
+    const double max_square = chord * chord;
+    Candidates found;
+
+    if (radius < 0)
+    {
+        return {};
+    }
+
+    SearchRadius(0, tree_.size(), point, max_square, found);
+
+    for (const Node &node : pending_)
+    {
+        if (const double square = SquaredChord(point, node.point); square <= max_square && !IsRemoved(node.stop))
+        {
+            found.emplace_back(square, node.stop);
+        }
+    }
+
+    const std::vector<double> distances = ComputeDistances(point, found);
+    StopDistances result;
+
+    for (size_t i = 0; i < found.size(); ++i)
+    {
+        if (distances[i] <= radius)
+        {
+            result.emplace_back(found[i].second, distances[i]);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto &lhs, const auto &rhs) {
+        return std::tie(lhs.second, lhs.first->name) < std::tie(rhs.second, rhs.first->name);
+    });
+
+    return result;
+}
+} // namespace spatial
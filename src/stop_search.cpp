@@ -0,0 +1,392 @@
+#include "../include/stop_search.h"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+namespace search
+{
+namespace
+{
+// Записей в буфере новых названий не больше этого числа перед слиянием с основным массивом
+constexpr size_t MAX_PENDING_SIZE = 4096;
+constexpr uint64_t NOT_FOUND = std::numeric_limits<uint64_t>::max();
+
+// Вид совпадения: всё название, начало названия, начало другого слова
+constexpr uint32_t WHOLE_NAME = 0;
+constexpr uint32_t NAME_PREFIX = 1;
+constexpr uint32_t WORD_PREFIX = 2;
+
+// Очередной символ UTF-8 начиная с pos; некорректный байт считается отдельным символом
+char32_t DecodeNext(std::string_view text, size_t &pos)
+{
+    const auto lead = static_cast<unsigned char>(text[pos]);
+    const size_t length = lead < 0x80 ? 1 : lead >> 5 == 0x6 ? 2 : lead >> 4 == 0xE ? 3 : lead >> 3 == 0x1E ? 4 : 0;
+
+    if (length <= 1 || pos + length > text.size())
+    {
+        ++pos;
+        return lead;
+    }
+
+    char32_t code_point = lead & (0x7F >> length);
+
+    for (size_t i = 1; i < length; ++i)
+    {
+        const auto next = static_cast<unsigned char>(text[pos + i]);
+
+        if (next >> 6 != 0x2)
+        {
+            ++pos;
+            return lead;
+        }
+
+        code_point = code_point << 6 | (next & 0x3F);
+    }
+
+    pos += length;
+
+    return code_point;
+}
+
+void Encode(char32_t code_point, std::string &out)
+{
+    if (code_point < 0x80)
+    {
+        out += static_cast<char>(code_point);
+    }
+
+    else if (code_point < 0x800)
+    {
+        out += static_cast<char>(0xC0 | code_point >> 6);
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+
+    else if (code_point < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | code_point >> 12);
+        out += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+
+    else
+    {
+        out += static_cast<char>(0xF0 | code_point >> 18);
+        out += static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+        out += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+char32_t FoldCodePoint(char32_t code_point)
+{
+    if (code_point >= U'A' && code_point <= U'Z')
+    {
+        return code_point + (U'a' - U'A');
+    }
+
+    if (code_point >= U'А' && code_point <= U'Я')
+    {
+        return code_point + (U'а' - U'А');
+    }
+
+    if (code_point == U'Ё' || code_point == U'ё')
+    {
+        return U'е';
+    }
+
+    // Ѐ..Џ (украинские, белорусские, сербские буквы) -> ѐ..џ
+    if (code_point >= 0x400 && code_point <= 0x40F)
+    {
+        return code_point + 0x50;
+    }
+
+    return code_point;
+}
+
+// Буквы и цифры; разделители слов — остальные символы ASCII, неразрывный пробел, кавычки-ёлочки и тире
+bool IsWordChar(char32_t code_point)
+{
+    if (code_point < 0x80)
+    {
+        return (code_point >= U'0' && code_point <= U'9') || (code_point >= U'a' && code_point <= U'z') ||
+               (code_point >= U'A' && code_point <= U'Z');
+    }
+
+    return code_point != 0xA0 && code_point != U'«' && code_point != U'»' && code_point != U'–' &&
+           code_point != U'—';
+}
+
+uint64_t MakeCode(size_t edits, uint32_t kind, size_t length)
+{
+    const size_t clamped = std::min<size_t>(length, std::numeric_limits<uint32_t>::max());
+
+    return static_cast<uint64_t>(edits << 2 | kind) << 32 | clamped;
+}
+} // namespace
+
+std::string StopNameIndex::Fold(std::string_view text)
+{
+    std::string folded;
+    folded.reserve(text.size());
+
+    for (size_t pos = 0; pos < text.size();)
+    {
+        Encode(FoldCodePoint(DecodeNext(text, pos)), folded);
+    }
+
+    return folded;
+}
+
+std::string_view StopNameIndex::GetKey(const Entry &entry) const
+{
+    return std::string_view(names_[entry.name].folded).substr(entry.offset);
+}
+
+void StopNameIndex::Add(const tc::Stop *stop)
+{
+    if (const auto it = name_indices_.find(stop->name); it != name_indices_.end())
+    {
+        const uint32_t index = it->second;
+        name_indices_.erase(it);
+        names_[index].stop = stop;
+        name_indices_.emplace(stop->name, index);
+        return;
+    }
+
+    const auto index = static_cast<uint32_t>(names_.size());
+    names_.push_back({Fold(stop->name), stop});
+    name_indices_.emplace(stop->name, index);
+
+    // Начало названия ищется всегда, даже если название начинается не с буквы
+    const std::string &folded = names_.back().folded;
+    Insert({index, 0});
+    bool in_word = false;
+
+    for (size_t pos = 0; pos < folded.size();)
+    {
+        const size_t start = pos;
+        const bool word_char = IsWordChar(DecodeNext(folded, pos));
+
+        if (word_char && !in_word && start > 0)
+        {
+            Insert({index, static_cast<uint32_t>(start)});
+        }
+
+        in_word = word_char;
+    }
+}
+
+void StopNameIndex::Insert(const Entry &entry)
+{
+    const auto by_key = [this](const Entry &lhs, const Entry &rhs) { return GetKey(lhs) < GetKey(rhs); };
+
+    pending_.insert(std::upper_bound(pending_.begin(), pending_.end(), entry, by_key), entry);
+
+    if (pending_.size() >= MAX_PENDING_SIZE)
+    {
+        const size_t middle = entries_.size();
+        entries_.insert(entries_.end(), pending_.begin(), pending_.end());
+        std::inplace_merge(entries_.begin(), entries_.begin() + middle, entries_.end(), by_key);
+        pending_.clear();
+    }
+}
+
+void StopNameIndex::Collect(const std::vector<Entry> &entries, std::string_view query,
+                            const std::u32string &code_points, size_t max_edits, std::vector<uint64_t> &codes,
+                            std::vector<uint32_t> &found) const
+{
+    // Все записи [begin, end) совпали с edits правками; у записей из начала названия длиной depth совпало всё название
+    auto record = [&](size_t begin, size_t end, size_t depth, size_t edits) {
+        if (edits > max_edits)
+        {
+            return;
+        }
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Entry &entry = entries[i];
+            const uint32_t kind = entry.offset != 0                              ? WORD_PREFIX
+                                  : names_[entry.name].folded.size() == depth ? WHOLE_NAME
+                                                                              : NAME_PREFIX;
+            const uint64_t code = MakeCode(edits, kind, names_[entry.name].folded.size());
+
+            if (codes[entry.name] == NOT_FOUND)
+            {
+                found.push_back(entry.name);
+            }
+
+            codes[entry.name] = std::min(codes[entry.name], code);
+        }
+    };
+
+    if (max_edits == 0)
+    {
+        const auto first = std::lower_bound(entries.begin(), entries.end(), query,
+                                            [this](const Entry &entry, std::string_view key) { return GetKey(entry) < key; });
+        const auto last = std::partition_point(first, entries.end(), [this, query](const Entry &entry) {
+            return GetKey(entry).substr(0, query.size()) == query;
+        });
+
+        record(first - entries.begin(), last - entries.begin(), query.size(), 0);
+        return;
+    }
+
+    // rows[level] — строка таблицы Левенштейна для узла глубины level: rows[level][j] — число правок,
+    // превращающих первые j символов запроса в начало ключа узла
+    const size_t width = code_points.size() + 1;
+    std::vector<size_t> rows(width);
+
+    for (size_t j = 0; j < width; ++j)
+    {
+        rows[j] = j;
+    }
+
+    // Узел — диапазон записей [begin, end) с общими первыми depth байтами ключа; best — меньше всего правок, с которыми
+    // совпало начало ключа у узла или его предков. Каждая запись учитывается один раз, в самом глубоком узле обхода:
+    // иначе частое слово переписывало бы коды одних и тех же тысяч записей на каждом уровне
+    auto descend = [&](auto &self, size_t begin, size_t end, size_t depth, size_t level, size_t best) -> void {
+        const size_t *row = rows.data() + level * width;
+        const size_t edits = row[width - 1];
+        const size_t least = *std::min_element(row, row + width);
+        best = std::min(best, edits);
+
+        // Записи, ключ которых кончается в этом узле, стоят в начале диапазона. Всё название совпало с edits правками,
+        // но если у предка начало совпало с меньшим числом, лучше тот код
+        size_t child = std::partition_point(entries.begin() + begin, entries.begin() + end,
+                                            [&](const Entry &entry) { return GetKey(entry).size() == depth; }) -
+                       entries.begin();
+        record(begin, child, best < edits ? std::string_view::npos : depth, best);
+
+        // Глубже правок не меньше least: спускаемся, только если так можно найти совпадение лучше
+        if (least >= std::min(edits, max_edits + 1))
+        {
+            record(child, end, depth, best);
+            return;
+        }
+
+        if (rows.size() < (level + 2) * width)
+        {
+            rows.resize((level + 2) * width);
+        }
+
+        while (child < end)
+        {
+            const std::string_view key = GetKey(entries[child]);
+            size_t next_depth = depth;
+            const char32_t code_point = DecodeNext(key, next_depth);
+            const std::string_view label = key.substr(depth, next_depth - depth);
+            const size_t child_end =
+                std::partition_point(entries.begin() + child, entries.begin() + end,
+                                     [&](const Entry &entry) { return GetKey(entry).substr(depth, label.size()) == label; }) -
+                entries.begin();
+
+            // Первая буква слова должна совпасть: опечатки в ней редки, а без этого поиск обходит почти всё дерево
+            if (level == 0 && code_point != code_points.front())
+            {
+                child = child_end;
+                continue;
+            }
+
+            const size_t *parent = rows.data() + level * width;
+            size_t *next = rows.data() + (level + 1) * width;
+            next[0] = parent[0] + 1;
+            size_t least = next[0];
+
+            for (size_t j = 1; j < width; ++j)
+            {
+                next[j] = std::min({parent[j] + 1, next[j - 1] + 1,
+                                    parent[j - 1] + (code_points[j - 1] == code_point ? 0 : 1)});
+                least = std::min(least, next[j]);
+            }
+
+            // Минимум строки с глубиной не убывает: если он уже больше допустимого, поддерево совпало только как
+            // продолжение этого узла
+            if (least <= max_edits)
+            {
+                self(self, child, child_end, next_depth, level + 1, best);
+            }
+
+            else
+            {
+                record(child, child_end, depth, best);
+            }
+
+            child = child_end;
+        }
+    };
+
+    descend(descend, 0, entries.size(), 0, 0, max_edits + 1);
+}
+
+StopNameIndex::Page StopNameIndex::Find(std::string_view query, size_t max_edits, size_t offset, size_t limit) const
+{
+    struct Scratch
+    {
+        std::vector<uint64_t> codes;
+        std::vector<uint32_t> found;
+    };
+
+    thread_local Scratch scratch;
+    auto &codes = scratch.codes;
+    auto &found = scratch.found;
+
+    const std::string folded = Fold(query);
+    std::u32string code_points;
+
+    for (size_t pos = 0; pos < folded.size();)
+    {
+        code_points += DecodeNext(folded, pos);
+    }
+
+    // Не больше одной правки на каждые четыре символа запроса: короткий запрос с опечатками совпал бы почти со всем
+    max_edits = std::min(max_edits, code_points.size() / 4);
+
+    if (codes.size() < names_.size())
+    {
+        codes.resize(names_.size(), NOT_FOUND);
+    }
+
+    Collect(entries_, folded, code_points, max_edits, codes, found);
+    Collect(pending_, folded, code_points, max_edits, codes, found);
+
+    const auto before = [&](uint32_t lhs, uint32_t rhs) {
+        return std::make_tuple(codes[lhs], std::string_view(names_[lhs].stop->name)) <
+               std::make_tuple(codes[rhs], std::string_view(names_[rhs].stop->name));
+    };
+
+    Page page;
+    page.total = found.size();
+    const size_t first = std::min(offset, found.size());
+    const size_t last = first + std::min(limit, found.size() - first);
+
+    // Частое слово даёт десятки тысяч совпадений, и сравнивать названия у всех дороже самого поиска.
+    // Страницу могут занять только названия с кодом не хуже last-го: остальные отбрасываются по одному числу
+    auto candidates_end = found.end();
+
+    if (last > 0 && last < found.size())
+    {
+        std::nth_element(found.begin(), found.begin() + last - 1, found.end(),
+                         [&](uint32_t lhs, uint32_t rhs) { return codes[lhs] < codes[rhs]; });
+        const uint64_t bound = codes[found[last - 1]];
+        candidates_end =
+            std::partition(found.begin() + last, found.end(), [&](uint32_t name) { return codes[name] <= bound; });
+    }
+
+    std::partial_sort(found.begin(), found.begin() + last, candidates_end, before);
+
+    for (size_t i = first; i < last; ++i)
+    {
+        page.stops.push_back(names_[found[i]].stop);
+    }
+
+    for (const uint32_t name : found)
+    {
+        codes[name] = NOT_FOUND;
+    }
+
+    found.clear();
+
+    return page;
+}
+} // namespace search
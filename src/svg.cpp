@@ -183,9 +183,9 @@ Text &Text::SetFontWeight(std::string font_weight)
     return *this;
 }
 
-Text &Text::SetData(std::string data)
+Text &Text::SetData(std::string_view data)
 {
-    data_ = std::move(data);
+    data_ = data;
     return *this;
 }
 
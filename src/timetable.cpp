@@ -0,0 +1,252 @@
+#include "../include/timetable.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+const double TIME = 6.00;
+const int MULTIPLIER = 100;
+
+namespace timetable
+{
+namespace
+{
+constexpr double UNREACHED = std::numeric_limits<double>::infinity();
+
+// Отправления с начальной остановки по таблице интервалов; без таблицы — весь день каждые default_interval минут
+std::vector<double> MakeDepartures(const std::vector<tc::Headway> *headways, double default_interval)
+{
+    const std::vector<tc::Headway> all_day{{0.0, MINUTES_PER_DAY, default_interval}};
+    std::vector<double> departures;
+
+    for (const tc::Headway &headway : headways ? *headways : all_day)
+    {
+        if (headway.interval <= 0.0)
+        {
+            throw std::invalid_argument("bus headway must be positive");
+        }
+
+        for (double time = headway.from; time < headway.to; time += headway.interval)
+        {
+            departures.push_back(time);
+        }
+    }
+
+    std::sort(departures.begin(), departures.end());
+    departures.erase(std::unique(departures.begin(), departures.end()), departures.end());
+
+    return departures;
+}
+} // namespace
+
+Timetable::Timetable(const tc::TransportCatalogue &catalogue, const tc::RoutingSettings &routing_settings)
+{
+    for (const auto &[name, stop] : catalogue.GetAllStops())
+    {
+        stop_indices_.emplace(stop, static_cast<uint32_t>(stops_.size()));
+        stops_.push_back(stop);
+    }
+
+    stop_lines_.resize(stops_.size());
+
+    // Автобус без расписания ходит с интервалом bus_wait_time, но не реже раза в минуту
+    const double default_interval = std::max(1, routing_settings.bus_wait_time_);
+
+    for (const auto &[number, bus] : catalogue.GetAllBuses())
+    {
+        if (bus->stops.size() < 2)
+        {
+            continue;
+        }
+
+        const auto schedule = routing_settings.bus_schedules_.find(std::string(number));
+        const std::vector<double> departures = MakeDepartures(
+            schedule == routing_settings.bus_schedules_.end() ? nullptr : &schedule->second, default_interval);
+
+        AddLine(catalogue, bus, bus->stops, departures, routing_settings.bus_velocity_);
+
+        if (!bus->is_roundtrip)
+        {
+            AddLine(catalogue, bus, {bus->stops.rbegin(), bus->stops.rend()}, departures,
+                    routing_settings.bus_velocity_);
+        }
+    }
+}
+
+void Timetable::AddLine(const tc::TransportCatalogue &catalogue, const tc::Bus *bus,
+                        std::vector<const tc::Stop *> stops, const std::vector<double> &departures, double velocity)
+{
+    const uint32_t line_index = static_cast<uint32_t>(lines_.size());
+    Line line;
+    line.bus = bus;
+    line.departures = departures;
+    line.stops.reserve(stops.size());
+    line.offsets.reserve(stops.size());
+
+    for (size_t i = 0; i < stops.size(); ++i)
+    {
+        const uint32_t stop = stop_indices_.at(stops[i]);
+        const double offset =
+            i == 0 ? 0.0 : line.offsets.back() + catalogue.GetDistance(stops[i - 1], stops[i]) / (velocity / TIME * MULTIPLIER);
+
+        line.stops.push_back(stop);
+        line.offsets.push_back(offset);
+        stop_lines_[stop].emplace_back(line_index, static_cast<uint32_t>(i));
+    }
+
+    lines_.push_back(std::move(line));
+}
+
+size_t Timetable::GetStopCount() const
+{
+    return stops_.size();
+}
+
+std::optional<uint32_t> Timetable::FindStopIndex(const tc::Stop *stop) const
+{
+    if (const auto it = stop_indices_.find(stop); it != stop_indices_.end())
+    {
+        return it->second;
+    }
+
+    return std::nullopt;
+}
+
+const tc::Stop *Timetable::GetStop(uint32_t index) const
+{
+    return stops_.at(index);
+}
+
+const std::vector<Line> &Timetable::GetLines() const
+{
+    return lines_;
+}
+
+const std::vector<std::pair<uint32_t, uint32_t>> &Timetable::GetStopLines(uint32_t stop) const
+{
+    return stop_lines_.at(stop);
+}
+
+std::optional<size_t> Timetable::NextTrip(const Line &line, size_t position, double time)
+{
+    const double offset = line.offsets[position];
+    const auto it = std::lower_bound(line.departures.begin(), line.departures.end(), time,
+                                     [offset](double departure, double time) { return departure + offset < time; });
+
+    if (it == line.departures.end())
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<size_t>(it - line.departures.begin());
+}
+
+std::optional<double> Timetable::NextDeparture(const Line &line, size_t position, double time)
+{
+    const auto trip = NextTrip(line, position, time);
+
+    if (!trip)
+    {
+        return std::nullopt;
+    }
+
+    return line.departures[*trip] + line.offsets[position];
+}
+
+std::optional<Journey> FindEarliestArrival(const Timetable &timetable, const tc::Stop *from, const tc::Stop *to,
+                                           double depart_at)
+{
+    const auto source = timetable.FindStopIndex(from);
+    const auto target = timetable.FindStopIndex(to);
+
+    if (!source || !target)
+    {
+        throw std::out_of_range("stop is not in timetable");
+    }
+
+    // Как попали на остановку: линия, позиции посадки и высадки, время отправления
+    struct Parent
+    {
+        uint32_t line;
+        uint32_t board;
+        uint32_t alight;
+        double departure;
+    };
+
+    std::vector<double> arrivals(timetable.GetStopCount(), UNREACHED);
+    std::vector<std::optional<Parent>> parents(timetable.GetStopCount());
+    std::vector<std::pair<double, uint32_t>> queue;
+    const std::greater<std::pair<double, uint32_t>> later;
+
+    arrivals[*source] = depart_at;
+    queue.emplace_back(depart_at, *source);
+
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), later);
+        const auto [time, stop] = queue.back();
+        queue.pop_back();
+
+        if (time > arrivals[stop])
+        {
+            continue;
+        }
+
+        if (stop == *target)
+        {
+            break;
+        }
+
+        for (const auto &[line_index, position] : timetable.GetStopLines(stop))
+        {
+            const Line &line = timetable.GetLines()[line_index];
+            const auto trip = Timetable::NextTrip(line, position, time);
+
+            if (!trip)
+            {
+                continue;
+            }
+
+            const double start = line.departures[*trip];
+            const double departure = start + line.offsets[position];
+
+            for (size_t next = position + 1; next < line.stops.size(); ++next)
+            {
+                const double arrival = start + line.offsets[next];
+                const uint32_t next_stop = line.stops[next];
+
+                if (arrival < arrivals[next_stop])
+                {
+                    arrivals[next_stop] = arrival;
+                    parents[next_stop] = Parent{line_index, position, static_cast<uint32_t>(next), departure};
+                    queue.emplace_back(arrival, next_stop);
+                    std::push_heap(queue.begin(), queue.end(), later);
+                }
+            }
+        }
+    }
+
+    if (arrivals[*target] == UNREACHED)
+    {
+        return std::nullopt;
+    }
+
+    Journey journey{depart_at, arrivals[*target], {}};
+
+    for (uint32_t stop = *target; parents[stop];)
+    {
+        const Parent &parent = *parents[stop];
+        const Line &line = timetable.GetLines()[parent.line];
+        const uint32_t board_stop = line.stops[parent.board];
+
+        journey.legs.push_back({line.bus, timetable.GetStop(board_stop), timetable.GetStop(stop),
+                                parent.alight - parent.board, parent.departure, arrivals[stop]});
+        stop = board_stop;
+    }
+
+    std::reverse(journey.legs.begin(), journey.legs.end());
+
+    return journey;
+}
+} // namespace timetable
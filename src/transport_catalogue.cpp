@@ -6,8 +6,18 @@ namespace tc
 {
 void TransportCatalogue::AddStop(tc::Stop stop)
 {
+    stop.sphere_point = geo::ToSpherePoint(stop.coordinates);
+
+    // Остановка с тем же названием заменяет прежнюю и в поиске по координатам
+    if (const Stop *previous = GetStop(stop.name))
+    {
+        stop_index_.Remove(previous);
+    }
+
     stops_.push_back(stop);
     stopname_to_stop_[stops_.back().name] = &stops_.back();
+    stop_index_.Add(&stops_.back());
+    stop_name_index_.Add(&stops_.back());
 }
 
 const Stop *TransportCatalogue::GetStop(std::string_view stop_name) const
@@ -30,12 +40,12 @@ void TransportCatalogue::AddBus(tc::Bus bus)
 
     for (const auto &bus_stop : bus.stops)
     {
-        for (auto &stop : stops_)
+        auto &stop_buses = stopname_to_stop_.at(bus_stop->name)->buses;
+        const auto position = std::lower_bound(stop_buses.begin(), stop_buses.end(), bus.number);
+
+        if (position == stop_buses.end() || *position != bus.number)
         {
-            if (stop.name == bus_stop->name)
-            {
-                stop.buses.insert(bus.number);
-            }
+            stop_buses.insert(position, bus.number);
         }
     }
 }
@@ -135,10 +145,24 @@ int TransportCatalogue::GetDistance(const Stop *from, const Stop *to) const
     }
 }
 
+const TransportCatalogue::HashedDistanceBtwStops &TransportCatalogue::GetAllDistances() const
+{
+    return dist_btw_stops;
+}
+
 std::pair<int, double> TransportCatalogue::GetRouteLength(const tc::Bus *bus) const
 {
     int route_length = 0;
     double geo_length = 0.0;
+    geo::CoordinateBatch stop_points;
+    std::vector<double> segment_lengths;
+
+    for (const Stop *stop : bus->stops)
+    {
+        stop_points.Add(stop->sphere_point);
+    }
+
+    stop_points.ComputeSegmentDistances(segment_lengths);
 
     for (size_t i = 0; i < bus->stops.size() - 1; ++i)
     {
@@ -148,13 +172,13 @@ std::pair<int, double> TransportCatalogue::GetRouteLength(const tc::Bus *bus) co
         if (bus->is_roundtrip)
         {
             route_length += GetDistance(from, to);
-            geo_length += geo::ComputeDistance(from->coordinates, to->coordinates);
+            geo_length += segment_lengths[i];
         }
 
         else
         {
             route_length += GetDistance(from, to) + GetDistance(to, from);
-            geo_length += geo::ComputeDistance(from->coordinates, to->coordinates) * 2;
+            geo_length += segment_lengths[i] * 2;
         }
     }
 
@@ -188,4 +212,14 @@ std::optional<tc::BusStat> TransportCatalogue::GetBusStat(const std::string_view
 
     return bus_stat;
 }
-} // namespace tc
\ No newline at end of file
+
+const spatial::StopIndex &TransportCatalogue::GetStopIndex() const
+{
+    return stop_index_;
+}
+
+const search::StopNameIndex &TransportCatalogue::GetStopNameIndex() const
+{
+    return stop_name_index_;
+}
+} // namespace tc
@@ -1,20 +1,89 @@
 #include "../include/transport_router.h"
+#include "../include/alternative_routes.h"
+#include "../include/bounded_search.h"
+#include "../include/catalogue_image.h"
+#include "../include/connection_scan.h"
+#include "../include/raptor.h"
+#include "../include/timetable.h"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
 
 const double TIME = 6.00;
 const int MULTIPLIER = 100;
 
+namespace
+{
+// Рекурсивная бисекция остановок по более протяжённой координате, пока в ячейке больше cell_size остановок.
+// Возвращает ячейку каждой вершины графа: обе вершины остановки попадают в одну ячейку
+std::vector<uint32_t> PartitionStops(const std::vector<const tc::Stop *> &stops, size_t cell_size)
+{
+    std::vector<uint32_t> vertex_cells(stops.size() * 2);
+    std::vector<size_t> order(stops.size());
+    std::vector<std::pair<size_t, size_t>> ranges{{0, order.size()}};
+    uint32_t cell_count = 0;
+    std::iota(order.begin(), order.end(), 0);
+    cell_size = std::max<size_t>(1, cell_size);
+
+    auto by_lat = [&stops](size_t lhs, size_t rhs) { return stops[lhs]->coordinates.lat < stops[rhs]->coordinates.lat; };
+    auto by_lng = [&stops](size_t lhs, size_t rhs) { return stops[lhs]->coordinates.lng < stops[rhs]->coordinates.lng; };
+
+    while (!ranges.empty())
+    {
+        const auto [begin, end] = ranges.back();
+        ranges.pop_back();
+
+        if (end - begin <= cell_size)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                vertex_cells[order[i] * 2] = vertex_cells[order[i] * 2 + 1] = cell_count;
+            }
+
+            ++cell_count;
+            continue;
+        }
+
+        const auto first = order.begin() + begin;
+        const auto last = order.begin() + end;
+        const auto [min_lat, max_lat] = std::minmax_element(first, last, by_lat);
+        const auto [min_lng, max_lng] = std::minmax_element(first, last, by_lng);
+        const size_t middle = begin + (end - begin) / 2;
+
+        if (stops[*max_lat]->coordinates.lat - stops[*min_lat]->coordinates.lat >=
+            stops[*max_lng]->coordinates.lng - stops[*min_lng]->coordinates.lng)
+        {
+            std::nth_element(first, order.begin() + middle, last, by_lat);
+        }
+
+        else
+        {
+            std::nth_element(first, order.begin() + middle, last, by_lng);
+        }
+
+        ranges.emplace_back(begin, middle);
+        ranges.emplace_back(middle, end);
+    }
+
+    return vertex_cells;
+}
+} // namespace
+
 namespace tc
 {
 void tc::TransportRouter::AddEdgesGraph(const TransportCatalogue &catalogue)
 {
     graph::VertexId vertex_id = 0;
-    std::map<const tc::Stop *, graph::VertexId> stop_to_vertex_id_ = {};
 
     for (const auto &[stop_name, stop_ptr] : catalogue.GetAllStops())
     {
         stop_to_vertex_id_[stop_ptr] = vertex_id;
+        vertex_stops_.push_back(stop_ptr);
         graph_.AddEdge(
             {stop_ptr->name, 0, vertex_id, ++vertex_id, static_cast<double>(routing_settings_.bus_wait_time_)});
+        edge_distances_.push_back(0);
 
         ++vertex_id;
     }
@@ -45,12 +114,14 @@ void tc::TransportRouter::AddEdgesGraph(const TransportCatalogue &catalogue)
                 graph_.AddEdge({bus_ptr->number, span_count, stop_to_vertex_id_.at(from) + 1, stop_to_vertex_id_.at(to),
 
                                 A_to_B / (routing_settings_.bus_velocity_ / TIME * MULTIPLIER)});
+                edge_distances_.push_back(A_to_B);
 
                 if (!bus_ptr->is_roundtrip)
                 {
                     graph_.AddEdge({bus_ptr->number, span_count, stop_to_vertex_id_.at(to) + 1,
                                     stop_to_vertex_id_.at(from),
                                     B_to_A / (routing_settings_.bus_velocity_ / TIME * MULTIPLIER)});
+                    edge_distances_.push_back(B_to_A);
                 }
 
                 ++span_count;
@@ -58,24 +129,382 @@ void tc::TransportRouter::AddEdgesGraph(const TransportCatalogue &catalogue)
         }
     }
 
-    router_ = std::make_unique<graph::Router<double>>(graph_);
+    // Пешие пересадки: соседние остановки ищутся по индексу координат, а не перебором всех пар.
+    // Длина пути — расстояние по дорогам, если оно задано, иначе по прямой
+    if (routing_settings_.walk_radius_ > 0.0)
+    {
+        for (const auto &[stop_name, from] : catalogue.GetAllStops())
+        {
+            for (const auto &[to, distance] :
+                 catalogue.GetStopIndex().FindInRadius(from->coordinates, routing_settings_.walk_radius_))
+            {
+                if (to == from)
+                {
+                    continue;
+                }
+
+                const int road_distance = catalogue.GetDistance(from, to);
+                const int walk_distance = road_distance > 0 ? road_distance : static_cast<int>(std::lround(distance));
+
+                graph_.AddEdge({to->name, 0, stop_to_vertex_id_.at(from), stop_to_vertex_id_.at(to),
+                                GetWalkTime(walk_distance)});
+                edge_distances_.push_back(walk_distance);
+            }
+        }
+    }
+}
+
+void tc::TransportRouter::BuildRouteEngine()
+{
+    if (routing_settings_.route_engine_ == RouteEngine::ALT)
+    {
+        BuildLandmarks();
+        return;
+    }
+
+    if (routing_settings_.route_engine_ == RouteEngine::CRP)
+    {
+        overlay_ = std::make_unique<graph::Overlay<double>>(
+            graph_,
+            std::make_shared<const graph::Partition>(graph_,
+                                                     PartitionStops(vertex_stops_, routing_settings_.cell_size_)),
+            routing_settings_.build_threads_);
+        return;
+    }
+
+    router_ = std::make_unique<graph::Router<double>>(graph_, routing_settings_.build_threads_);
     router_->SetVertexId(stop_to_vertex_id_);
 }
 
+void tc::TransportRouter::BuildLandmarks()
+{
+    // Ориентиры — вершины ожидания остановок, через которые ходят автобусы
+    std::vector<graph::VertexId> candidates;
+
+    for (graph::VertexId vertex = 0; vertex < graph_.GetVertexCount(); vertex += 2)
+    {
+        const auto bus_edges = graph_.GetIncidentEdges(vertex + 1);
+
+        if (bus_edges.begin() != bus_edges.end())
+        {
+            candidates.push_back(vertex);
+        }
+    }
+
+    landmarks_ = std::make_unique<graph::LandmarkIndex<double>>(
+        graph_, candidates, routing_settings_.landmark_count_, routing_settings_.build_threads_);
+
+    // Путь по дорогам складывается из перегонов и пеших пересадок, и по прямой он не короче расстояния между концами,
+    // так что наименьшее отношение время / расстояние по прямой среди них годится для всего пути
+    geo_time_factor_ = std::numeric_limits<double>::infinity();
+
+    for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id)
+    {
+        const auto &edge = graph_.GetEdge(edge_id);
+
+        if (edge.span_count != 1 && !IsWalkEdge(edge))
+        {
+            continue;
+        }
+
+        const double distance = geo::ComputeDistance(vertex_stops_[edge.from / 2]->sphere_point,
+                                                     vertex_stops_[edge.to / 2]->sphere_point);
+
+        if (distance > 0.0)
+        {
+            geo_time_factor_ = std::min(geo_time_factor_, edge.weight / distance);
+        }
+    }
+
+    // Запас на погрешность сложения весов вдоль пути
+    geo_time_factor_ = std::isinf(geo_time_factor_) ? 0.0 : geo_time_factor_ * (1.0 - 1e-9);
+}
+
+double tc::TransportRouter::GetLowerBound(graph::VertexId vertex, graph::VertexId vertex_to, const Stop *stop_to) const
+{
+    double bound =
+        geo_time_factor_ * geo::ComputeDistance(vertex_stops_[vertex / 2]->sphere_point, stop_to->sphere_point);
+
+    // Из вершины ожидания другой остановки не уехать, не дождавшись автобуса; с пешими пересадками можно уйти пешком
+    if (vertex % 2 == 0 && vertex != vertex_to && !(routing_settings_.walk_radius_ > 0.0))
+    {
+        bound += routing_settings_.bus_wait_time_;
+    }
+
+    return std::max(bound, landmarks_->GetLowerBound(vertex, vertex_to));
+}
+
 void tc::TransportRouter::BuildGraph(const TransportCatalogue &catalogue)
 {
     graph_ = graph::DirectedWeightedGraph<double>(catalogue.GetAllStops().size() * 2);
     AddEdgesGraph(catalogue);
+    BuildRouteEngine();
+    BuildTimetable(catalogue);
+}
+
+void tc::TransportRouter::BuildTimetable(const TransportCatalogue &catalogue)
+{
+    timetable_ = std::make_shared<const timetable::Timetable>(catalogue, routing_settings_);
+
+    if (routing_settings_.timetable_engine_ == TimetableEngine::CONNECTION_SCAN)
+    {
+        connection_scan_ = std::make_shared<const timetable::ConnectionScan>(*timetable_);
+    }
+}
+
+TransportRouter::TransportRouter(const TransportRouter &base, const RoutingSettings &routing_settings,
+                                 const TransportCatalogue &catalogue)
+    : graph_(base.graph_.GetVertexCount()), stop_to_vertex_id_(base.stop_to_vertex_id_),
+      vertex_stops_(base.vertex_stops_), edge_distances_(base.edge_distances_), generation_(NextGeneration()),
+      routing_settings_(routing_settings)
+{
+    if (!base.overlay_)
+    {
+        throw std::logic_error("router has no partition to customize");
+    }
+
+    for (graph::EdgeId edge_id = 0; edge_id < base.graph_.GetEdgeCount(); ++edge_id)
+    {
+        graph::Edge<double> edge = base.graph_.GetEdge(edge_id);
+
+        if (IsWalkEdge(edge))
+        {
+            edge.weight = GetWalkTime(edge_distances_[edge_id]);
+        }
+
+        else
+        {
+            edge.weight = edge.span_count == 0
+                              ? static_cast<double>(routing_settings_.bus_wait_time_)
+                              : edge_distances_[edge_id] / (routing_settings_.bus_velocity_ / TIME * MULTIPLIER);
+        }
+
+        graph_.AddEdge(edge);
+    }
+
+    overlay_ = std::make_unique<graph::Overlay<double>>(graph_, base.overlay_->GetPartition(),
+                                                        routing_settings_.build_threads_);
+    BuildTimetable(catalogue);
+}
+
+TransportRouter::TransportRouter(std::shared_ptr<const image::CatalogueImage> image,
+                                 const TransportCatalogue &catalogue)
+    : graph_(image->MakeGraph()), image_(std::move(image)), edge_distances_(image_->GetEdgeDistances()),
+      generation_(NextGeneration()), routing_settings_(image_->GetRoutingSettings())
+{
+    // Остановки в образе записаны в порядке GetAllStops(), i-й остановке соответствует вершина 2 * i
+    for (size_t i = 0; i < image_->GetStopCount(); ++i)
+    {
+        const Stop *stop = catalogue.GetStop(image_->GetStopName(i));
+        stop_to_vertex_id_[stop] = i * 2;
+        vertex_stops_.push_back(stop);
+    }
+
+    // Таблица маршрутов в образе есть только у RouteEngine::ALL_PAIRS
+    if (!image_->HasRouteTable())
+    {
+        image_.reset();
+        BuildRouteEngine();
+    }
+
+    BuildTimetable(catalogue);
 }
 
 const std::optional<graph::Router<double>::RouteInfo> TransportRouter::GetRoute(const tc::Stop *from,
                                                                                 const tc::Stop *to) const
 {
-    return router_->BuildRoute(router_->GetVertexId(from), router_->GetVertexId(to));
+    const graph::VertexId vertex_from = stop_to_vertex_id_.at(from);
+    const graph::VertexId vertex_to = stop_to_vertex_id_.at(to);
+
+    if (image_)
+    {
+        return image_->BuildRoute(vertex_from, vertex_to);
+    }
+
+    if (overlay_)
+    {
+        return overlay_->BuildRoute(vertex_from, vertex_to);
+    }
+
+    if (landmarks_)
+    {
+        return graph::FindRouteAStar(graph_, vertex_from, vertex_to, [&](graph::VertexId vertex) {
+            return GetLowerBound(vertex, vertex_to, to);
+        });
+    }
+
+    return router_->BuildRoute(vertex_from, vertex_to);
+}
+
+std::vector<std::optional<double>> TransportRouter::GetRouteTimes(const tc::Stop *from,
+                                                                  const std::vector<const tc::Stop *> &to) const
+{
+    const graph::VertexId vertex_from = stop_to_vertex_id_.at(from);
+    std::vector<std::optional<double>> times;
+    times.reserve(to.size());
+
+    // Без таблицы маршрутов строку считаем одним поиском из stop_from
+    if (!image_ && !router_)
+    {
+        std::vector<std::optional<double>> row(graph_.GetVertexCount());
+
+        for (const auto &[vertex, time] :
+             graph::FindReachable(graph_, vertex_from, std::numeric_limits<double>::max()))
+        {
+            row[vertex] = time;
+        }
+
+        for (const tc::Stop *stop : to)
+        {
+            times.push_back(row[stop_to_vertex_id_.at(stop)]);
+        }
+
+        return times;
+    }
+
+    for (const tc::Stop *stop : to)
+    {
+        const graph::VertexId vertex_to = stop_to_vertex_id_.at(stop);
+
+        if (image_)
+        {
+            times.push_back(image_->GetRouteWeight(vertex_from, vertex_to));
+        }
+
+        else if (const auto route_data = router_->GetRouteData(vertex_from, vertex_to))
+        {
+            times.push_back(route_data->first);
+        }
+
+        else
+        {
+            times.push_back(std::nullopt);
+        }
+    }
+
+    return times;
+}
+
+std::vector<std::pair<const tc::Stop *, double>> TransportRouter::GetReachableStops(const tc::Stop *from,
+                                                                                    double max_time) const
+{
+    std::vector<std::pair<const tc::Stop *, double>> stops;
+
+    // Прибытие на остановку — это попадание в её вершину ожидания, у которой чётный номер
+    for (const auto &[vertex, time] : graph::FindReachable(graph_, stop_to_vertex_id_.at(from), max_time))
+    {
+        if (vertex % 2 == 0)
+        {
+            stops.emplace_back(vertex_stops_[vertex / 2], time);
+        }
+    }
+
+    return stops;
+}
+
+std::optional<graph::MultiRouteInfo<double>> TransportRouter::GetRouteBetween(
+    const std::vector<std::pair<const tc::Stop *, double>> &stops_from,
+    const std::vector<std::pair<const tc::Stop *, double>> &stops_to) const
+{
+    std::vector<std::pair<graph::VertexId, double>> sources;
+    std::vector<std::pair<graph::VertexId, double>> targets;
+    sources.reserve(stops_from.size());
+    targets.reserve(stops_to.size());
+
+    // Начало и конец — вершины ожидания: маршрут, как и обычный, начинается с ожидания автобуса
+    for (const auto &[stop, time] : stops_from)
+    {
+        sources.emplace_back(stop_to_vertex_id_.at(stop), time);
+    }
+
+    for (const auto &[stop, time] : stops_to)
+    {
+        targets.emplace_back(stop_to_vertex_id_.at(stop), time);
+    }
+
+    return graph::FindRouteBetween(graph_, sources, targets);
+}
+
+double TransportRouter::GetWalkTime(double distance) const
+{
+    return distance / (routing_settings_.walk_speed_ / TIME * MULTIPLIER);
+}
+
+bool TransportRouter::IsWalkEdge(const graph::Edge<double> &edge)
+{
+    return edge.from % 2 == 0 && edge.to % 2 == 0;
+}
+
+const tc::Stop *TransportRouter::GetVertexStop(graph::VertexId vertex) const
+{
+    return vertex_stops_.at(vertex / 2);
 }
 
 const graph::DirectedWeightedGraph<double> &TransportRouter::GetRouteGraph() const
 {
-    return router_->GetGraph();
+    return graph_;
+}
+
+const graph::Router<double> *TransportRouter::GetRouter() const
+{
+    return router_.get();
+}
+
+const image::CatalogueImage *TransportRouter::GetImage() const
+{
+    return image_.get();
+}
+
+const std::vector<int> &TransportRouter::GetEdgeDistances() const
+{
+    return edge_distances_;
+}
+
+const timetable::Timetable &TransportRouter::GetTimetable() const
+{
+    return *timetable_;
+}
+
+std::optional<timetable::Journey> TransportRouter::GetJourney(const tc::Stop *from, const tc::Stop *to,
+                                                             double depart_at) const
+{
+    if (connection_scan_)
+    {
+        return connection_scan_->FindEarliestArrival(from, to, depart_at);
+    }
+
+    return timetable::FindEarliestArrival(*timetable_, from, to, depart_at);
+}
+
+std::vector<graph::Router<double>::RouteInfo> TransportRouter::GetAlternativeRoutes(const tc::Stop *from,
+                                                                                   const tc::Stop *to, size_t count,
+                                                                                   double max_stretch) const
+{
+    return graph::FindAlternativeRoutes(graph_, stop_to_vertex_id_.at(from), stop_to_vertex_id_.at(to), count,
+                                        max_stretch);
+}
+
+std::vector<timetable::Journey> TransportRouter::GetParetoJourneys(const tc::Stop *from, const tc::Stop *to,
+                                                                   std::optional<double> depart_at,
+                                                                   size_t max_transfers) const
+{
+    return timetable::Raptor(*timetable_, routing_settings_).FindParetoJourneys(from, to, depart_at, max_transfers);
+}
+
+const RoutingSettings &TransportRouter::GetRoutingSettings() const
+{
+    return routing_settings_;
+}
+
+uint64_t TransportRouter::GetGeneration() const
+{
+    return generation_;
+}
+
+uint64_t TransportRouter::NextGeneration()
+{
+    static std::atomic<uint64_t> generation{0};
+
+    return ++generation;
 }
 } // namespace tc
\ No newline at end of file